@@ -0,0 +1,264 @@
+#pragma once
+
+#include "engine.h"
+#include "rule.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Bit-packed engine: one bit per cell, rows padded to whole words, bit i of
+// word k in a row is column k * bits + i. Neighbor counts are summed across
+// whole words with a full-adder network and the rule is applied as a
+// sum-of-products over the count bits (see minimizeRule in rule.h).
+
+template <typename Word>
+struct RowShape {
+    static constexpr int BITS = sizeof(Word) * 8;
+    int width, words, lastBits;
+    Word lastMask;
+
+    RowShape(int width) : width(width), words((width + BITS - 1) / BITS) {
+        lastBits = width - (words - 1) * BITS;
+        lastMask = lastBits == BITS ? ~Word(0) : (Word(1) << lastBits) - 1;
+    }
+};
+
+// West/east neighbor planes of word i: bit j holds the cell left/right of
+// column i * BITS + j.
+template <Boundary B, typename Word>
+inline void edgeNeighbors(const Word* row, int i, const RowShape<Word>& shape, Word& west, Word& east) {
+    const int BITS = RowShape<Word>::BITS;
+    Word w = row[i];
+    Word westBit, eastBit;
+    if (i > 0) westBit = row[i - 1] >> (BITS - 1);
+    else westBit = B == Boundary::Torus ? (row[shape.words - 1] >> (shape.lastBits - 1)) & 1 : 0;
+    if (i < shape.words - 1) eastBit = row[i + 1] & 1;
+    else eastBit = B == Boundary::Torus ? row[0] & 1 : 0;
+    int valid = i == shape.words - 1 ? shape.lastBits : BITS;
+    west = (w << 1) | westBit;
+    east = (w >> 1) | (eastBit << (valid - 1));
+}
+
+// Bit-sliced neighbor count: c0..c3 are the binary digits of the count.
+template <typename Word, bool NeedBit3>
+inline void countNeighbors(Word nw, Word n, Word ne, Word w, Word e, Word sw, Word s, Word se,
+                           Word& c0, Word& c1, Word& c2, Word& c3) {
+    Word u0 = nw ^ n ^ ne, u1 = (nw & n) | (ne & (nw ^ n));
+    Word d0 = sw ^ s ^ se, d1 = (sw & s) | (se & (sw ^ s));
+    Word m0 = w ^ e, m1 = w & e;
+    c0 = u0 ^ d0 ^ m0;
+    Word carry = (u0 & d0) | (m0 & (u0 ^ d0));
+    Word p0 = u1 ^ d1 ^ m1, p1 = (u1 & d1) | (m1 & (u1 ^ d1));
+    c1 = p0 ^ carry;
+    Word q1 = p0 & carry;
+    c2 = p1 ^ q1;
+    c3 = NeedBit3 ? p1 & q1 : 0;
+}
+
+template <typename Word>
+inline Word evalTerm(RuleTerm term, Word alive, Word c0, Word c1, Word c2, Word c3) {
+    Word inputs[RULE_VAR_COUNT] = { c0, c1, c2, c3, alive };
+    Word result = ~Word(0);
+    for (int v = 0; v < RULE_VAR_COUNT; v++) {
+        if (!(term.mask & (1 << v))) continue;
+        result &= (term.value & (1 << v)) ? inputs[v] : ~inputs[v];
+    }
+    return result;
+}
+
+// Rule fixed at compile time: the cover is a constant expression, so each
+// term folds down to a handful of and/andnot instructions.
+template <uint16_t Birth, uint16_t Survive>
+struct StaticRuleLogic {
+    static constexpr RuleCover COVER = minimizeRule(Rule{ Birth, Survive });
+    static constexpr bool NEED_BIT3 = coverUsesVar(COVER, 3);
+
+    StaticRuleLogic() {}
+    explicit StaticRuleLogic(Rule) {}
+
+    template <typename Word, size_t... I>
+    static inline Word applyTerms(Word alive, Word c0, Word c1, Word c2, Word c3, std::index_sequence<I...>) {
+        return (Word(0) | ... | evalTerm<Word>(COVER.terms[I], alive, c0, c1, c2, c3));
+    }
+
+    template <typename Word>
+    inline Word next(Word alive, Word c0, Word c1, Word c2, Word c3) const {
+        return applyTerms(alive, c0, c1, c2, c3, std::make_index_sequence<COVER.count>());
+    }
+};
+
+// Fallback for rules without a compiled kernel.
+struct DynamicRuleLogic {
+    static constexpr bool NEED_BIT3 = true;
+    RuleCover cover;
+
+    DynamicRuleLogic(Rule rule) : cover(minimizeRule(rule)) {}
+
+    template <typename Word>
+    inline Word next(Word alive, Word c0, Word c1, Word c2, Word c3) const {
+        Word result = 0;
+        for (int i = 0; i < cover.count; i++) result |= evalTerm(cover.terms[i], alive, c0, c1, c2, c3);
+        return result;
+    }
+};
+
+template <class Logic, Boundary B, typename Word>
+void stepBitGrid(const Logic& logic, const Word* src, Word* dst, int width, int height) {
+    RowShape<Word> shape(width);
+    std::vector<Word> zeroRow(shape.words, 0);
+    for (int y = 0; y < height; y++) {
+        const Word* up = y > 0 ? src + (y - 1) * shape.words
+                       : B == Boundary::Torus ? src + (height - 1) * shape.words : zeroRow.data();
+        const Word* down = y < height - 1 ? src + (y + 1) * shape.words
+                         : B == Boundary::Torus ? src : zeroRow.data();
+        const Word* row = src + y * shape.words;
+        Word* out = dst + y * shape.words;
+        auto stepWord = [&](int i, Word nw, Word ne, Word w, Word e, Word sw, Word se) {
+            Word c0, c1, c2, c3;
+            countNeighbors<Word, Logic::NEED_BIT3>(nw, up[i], ne, w, e, sw, down[i], se, c0, c1, c2, c3);
+            return logic.template next<Word>(row[i], c0, c1, c2, c3);
+        };
+        // Interior words take their carries straight from the adjacent words;
+        // only the first and last word of a row see the boundary.
+        const int BITS = RowShape<Word>::BITS;
+        for (int i = 1; i < shape.words - 1; i++) {
+            out[i] = stepWord(i,
+                (up[i] << 1) | (up[i - 1] >> (BITS - 1)), (up[i] >> 1) | (up[i + 1] << (BITS - 1)),
+                (row[i] << 1) | (row[i - 1] >> (BITS - 1)), (row[i] >> 1) | (row[i + 1] << (BITS - 1)),
+                (down[i] << 1) | (down[i - 1] >> (BITS - 1)), (down[i] >> 1) | (down[i + 1] << (BITS - 1)));
+        }
+        int edges[2] = { 0, shape.words - 1 };
+        for (int k = 0; k < (shape.words > 1 ? 2 : 1); k++) {
+            int i = edges[k];
+            Word nw, ne, w, e, sw, se;
+            edgeNeighbors<B>(up, i, shape, nw, ne);
+            edgeNeighbors<B>(row, i, shape, w, e);
+            edgeNeighbors<B>(down, i, shape, sw, se);
+            Word next = stepWord(i, nw, ne, w, e, sw, se);
+            out[i] = i == shape.words - 1 ? next & shape.lastMask : next;
+        }
+    }
+}
+
+typedef void (*BitKernel)(const void* src, void* dst, int width, int height, Rule rule);
+
+template <uint16_t Birth, uint16_t Survive, Boundary B, typename Word>
+void staticBitKernel(const void* src, void* dst, int width, int height, Rule) {
+    stepBitGrid<StaticRuleLogic<Birth, Survive>, B, Word>(StaticRuleLogic<Birth, Survive>(),
+        static_cast<const Word*>(src), static_cast<Word*>(dst), width, height);
+}
+
+template <Boundary B, typename Word>
+void dynamicBitKernel(const void* src, void* dst, int width, int height, Rule rule) {
+    stepBitGrid<DynamicRuleLogic, B, Word>(DynamicRuleLogic(rule),
+        static_cast<const Word*>(src), static_cast<Word*>(dst), width, height);
+}
+
+struct BitKernelEntry {
+    Rule rule;
+    Boundary boundary;
+    int wordBits;
+    BitKernel kernel;
+};
+
+// Rules with dedicated kernels; anything else runs the dynamic cover.
+#define FOR_EACH_COMPILED_RULE(X) \
+    X(0x008, 0x00C)  /* B3/S23 Life */ \
+    X(0x048, 0x00C)  /* B36/S23 HighLife */ \
+    X(0x004, 0x000)  /* B2/S Seeds */ \
+    X(0x1C8, 0x1D8)  /* B3678/S34678 Day & Night */ \
+    X(0x008, 0x1FF)  /* B3/S012345678 Life without Death */ \
+    X(0x0AA, 0x0AA)  /* B1357/S1357 Replicator */
+
+#define BIT_KERNELS_FOR_RULE(B, S) \
+    { { B, S }, Boundary::Torus, 32, &staticBitKernel<B, S, Boundary::Torus, uint32_t> }, \
+    { { B, S }, Boundary::Torus, 64, &staticBitKernel<B, S, Boundary::Torus, uint64_t> }, \
+    { { B, S }, Boundary::Dead, 32, &staticBitKernel<B, S, Boundary::Dead, uint32_t> }, \
+    { { B, S }, Boundary::Dead, 64, &staticBitKernel<B, S, Boundary::Dead, uint64_t> },
+
+static const BitKernelEntry BIT_KERNELS[] = {
+    FOR_EACH_COMPILED_RULE(BIT_KERNELS_FOR_RULE)
+};
+
+inline BitKernel findBitKernel(Rule rule, Boundary boundary, int wordBits, bool& specialized) {
+    for (const BitKernelEntry& entry : BIT_KERNELS) {
+        if (entry.rule == rule && entry.boundary == boundary && entry.wordBits == wordBits) {
+            specialized = true;
+            return entry.kernel;
+        }
+    }
+    specialized = false;
+    if (boundary == Boundary::Torus) return wordBits == 32 ? &dynamicBitKernel<Boundary::Torus, uint32_t> : &dynamicBitKernel<Boundary::Torus, uint64_t>;
+    return wordBits == 32 ? &dynamicBitKernel<Boundary::Dead, uint32_t> : &dynamicBitKernel<Boundary::Dead, uint64_t>;
+}
+
+class BitwiseEngine : public Engine {
+private:
+    int width, height, wordBits, wordsPerRow;
+    Rule rule;
+    BitKernel kernel;
+    bool specialized;
+    // Only the pair matching wordBits is allocated, so each grid is only
+    // ever accessed through its own element type.
+    std::vector<uint32_t> narrowGrids[2];
+    std::vector<uint64_t> wideGrids[2];
+    int current;
+
+    std::vector<uint32_t>& grid(int i, uint32_t) { return narrowGrids[i]; }
+    std::vector<uint64_t>& grid(int i, uint64_t) { return wideGrids[i]; }
+    const std::vector<uint32_t>& grid(int i, uint32_t) const { return narrowGrids[i]; }
+    const std::vector<uint64_t>& grid(int i, uint64_t) const { return wideGrids[i]; }
+    void* gridData(int i) { return wordBits == 32 ? static_cast<void*>(narrowGrids[i].data()) : wideGrids[i].data(); }
+
+    template <typename Word>
+    void loadWords(const uint8_t* cells) {
+        std::vector<Word>& words = grid(current, Word());
+        std::fill(words.begin(), words.end(), 0);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                if (cells[y * width + x]) words[y * wordsPerRow + x / wordBits] |= Word(1) << (x % wordBits);
+            }
+        }
+    }
+
+    template <typename Word>
+    void storeWords(uint8_t* cells) const {
+        const std::vector<Word>& words = grid(current, Word());
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                cells[y * width + x] = (words[y * wordsPerRow + x / wordBits] >> (x % wordBits)) & 1 ? 255 : 0;
+            }
+        }
+    }
+
+public:
+    BitwiseEngine(int width, int height, Rule rule, Boundary boundary, int wordBits)
+        : width(width), height(height), wordBits(wordBits == 32 ? 32 : 64), rule(rule), current(0) {
+        wordsPerRow = (width + this->wordBits - 1) / this->wordBits;
+        kernel = findBitKernel(rule, boundary, this->wordBits, specialized);
+        size_t words = size_t(wordsPerRow) * height;
+        for (int i = 0; i < 2; i++) {
+            if (this->wordBits == 32) narrowGrids[i].assign(words, 0);
+            else wideGrids[i].assign(words, 0);
+        }
+    }
+
+    const char* name() const override { return specialized ? "bitwise" : "bitwise (dynamic rule)"; }
+
+    void load(const uint8_t* cells) override {
+        if (wordBits == 32) loadWords<uint32_t>(cells);
+        else loadWords<uint64_t>(cells);
+    }
+
+    void store(uint8_t* cells) const override {
+        if (wordBits == 32) storeWords<uint32_t>(cells);
+        else storeWords<uint64_t>(cells);
+    }
+
+    void step() override {
+        kernel(gridData(current), gridData(1 - current), width, height, rule);
+        current = 1 - current;
+    }
+};
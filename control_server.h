@@ -0,0 +1,184 @@
+#pragma once
+
+#include "spsc_queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+#define CONTROL_MAX_STEPS 1000000000LL  // largest N a single "step N" accepts
+
+enum class ControlOp { Step, Pause, Resume, Set, Population, Region, Checkpoint };
+
+// One parsed request line:
+//   step N | pause | resume | set X Y RLE | population | region X Y W H | checkpoint PATH
+struct ControlCommand {
+    ControlOp op;
+    long long x, y;
+    int width, height;
+    unsigned long long count;
+    std::string text;  // RLE body for set, file name for checkpoint
+};
+
+inline bool parseControlCommand(const std::string& line, ControlCommand& command, std::string& error) {
+    std::istringstream in(line);
+    std::string verb;
+    in >> verb;
+    command = ControlCommand{ ControlOp::Pause, 0, 0, 0, 0, 0, "" };
+    if (verb == "step") {
+        command.op = ControlOp::Step;
+        command.count = 1;
+        std::string word;
+        if (in >> word) {
+            char* end;
+            long long count = strtoll(word.c_str(), &end, 10);
+            if (*end || count <= 0 || count > CONTROL_MAX_STEPS) {
+                error = "step count must be 1 to " + std::to_string(CONTROL_MAX_STEPS);
+                return false;
+            }
+            command.count = count;
+        }
+    } else if (verb == "pause") {
+        command.op = ControlOp::Pause;
+    } else if (verb == "resume") {
+        command.op = ControlOp::Resume;
+    } else if (verb == "set") {
+        command.op = ControlOp::Set;
+        if (!(in >> command.x >> command.y)) { error = "usage: set X Y RLE"; return false; }
+        std::getline(in >> std::ws, command.text);
+        if (command.text.empty()) { error = "usage: set X Y RLE"; return false; }
+    } else if (verb == "population") {
+        command.op = ControlOp::Population;
+    } else if (verb == "region") {
+        command.op = ControlOp::Region;
+        if (!(in >> command.x >> command.y >> command.width >> command.height) || command.width <= 0 || command.height <= 0) {
+            error = "usage: region X Y W H";
+            return false;
+        }
+    } else if (verb == "checkpoint") {
+        command.op = ControlOp::Checkpoint;
+        if (!(in >> command.text)) { error = "usage: checkpoint PATH"; return false; }
+    } else {
+        error = "unknown command: " + verb;
+        return false;
+    }
+    return true;
+}
+
+// Serves a line protocol on a Unix-domain socket from its own thread. Parsed
+// commands go to the simulation through a lock-free queue and are applied
+// between generations; each reply comes back through a second queue and is
+// written as its text followed by "ok" or a single "error: ..." line. Clients
+// are served one at a time, and the simulation never waits on the socket.
+class ControlServer {
+private:
+    std::string path;
+    int listener;
+    std::atomic<bool> stopping;
+    std::thread thread;
+    SpscQueue<ControlCommand, 64> commands;
+    SpscQueue<std::string, 64> replies;
+
+    bool sendAll(int fd, const std::string& data) {
+        for (size_t sent = 0; sent < data.size();) {
+            ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) return false;
+            sent += n;
+        }
+        return true;
+    }
+
+    // Waits for fd to become readable, giving up when the server stops.
+    bool waitReadable(int fd) {
+        pollfd p = { fd, POLLIN, 0 };
+        while (!stopping) {
+            if (poll(&p, 1, 100) > 0) return true;
+        }
+        return false;
+    }
+
+    void serve(int client) {
+        std::string buffer;
+        char chunk[4096];
+        while (waitReadable(client)) {
+            ssize_t n = recv(client, chunk, sizeof(chunk), 0);
+            if (n <= 0) return;
+            buffer.append(chunk, n);
+            size_t newline;
+            while ((newline = buffer.find('\n')) != std::string::npos) {
+                std::string line = buffer.substr(0, newline);
+                buffer.erase(0, newline + 1);
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if (line.empty()) continue;
+                ControlCommand command;
+                std::string error, reply;
+                if (!parseControlCommand(line, command, error)) {
+                    reply = "error: " + error + "\n";
+                } else {
+                    while (!commands.push(std::move(command))) {
+                        if (stopping) return;
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }
+                    while (!replies.pop(reply)) {
+                        if (stopping) return;
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }
+                }
+                if (!sendAll(client, reply)) return;
+            }
+        }
+    }
+
+    void run() {
+        while (waitReadable(listener)) {
+            int client = accept(listener, nullptr, nullptr);
+            if (client < 0) continue;
+            serve(client);
+            close(client);
+        }
+    }
+
+public:
+    ControlServer(const std::string& path) : path(path), listener(-1), stopping(false) {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) { std::cerr << "Control socket path too long\n"; return; }
+        strcpy(address.sun_path, path.c_str());
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0) { std::cerr << "Could not create control socket\n"; return; }
+        unlink(path.c_str());
+        if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 4) != 0) {
+            std::cerr << "Could not listen on " << path << "\n";
+            close(listener);
+            listener = -1;
+            return;
+        }
+        thread = std::thread(&ControlServer::run, this);
+    }
+
+    ~ControlServer() {
+        stopping = true;
+        if (thread.joinable()) thread.join();
+        if (listener >= 0) {
+            close(listener);
+            unlink(path.c_str());
+        }
+    }
+
+    bool ok() const { return listener >= 0; }
+
+    // Simulation side: take the next command, if any, and answer it with
+    // reply() before taking another.
+    bool nextCommand(ControlCommand& command) { return commands.pop(command); }
+    void reply(bool success, const std::string& text) { replies.push(success ? text + "ok\n" : "error: " + text + "\n"); }
+};
@@ -1,46 +1,182 @@
-//g++ -o conway conway_working.cpp -lglfw -lGLEW -lGL;
+//g++ -o conway conway_working.cpp -lglfw -lGLEW -lGL -lpthread -lrt;
+// Add -DCONWAY_VULKAN -lvulkan -lshaderc_shared for --engine=vulkan.
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <atomic>
+#include <chrono>
+#include <climits>
 #include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bitwise_engine.h"
+#include "control_server.h"
+#include "frame_pacing.h"
+#include "hashlife.h"
+#include "labeling.h"
+#include "lut_engine.h"
+#include "object_tracker.h"
+#include "rle.h"
+#include "rng.h"
+#include "tiled_engine.h"
+#include "rule.h"
+#include "shader_gen.h"
+#include "shm_publisher.h"
+#include "soup_sweep.h"
+#ifdef CONWAY_VULKAN
+#include "vulkan_engine.h"
+#endif
 
 #define WIDTH 2000
 #define HEIGHT 2000
+#define BENCH_BATCH 256  // largest batch --bench-dispatch submits at once
+#define CONTROL_STEP_SECONDS 0.008  // stepping a control "step N" may take per call
+
+struct Options {
+    std::string engine = "gpu";
+    Rule rule = LIFE_RULE;
+    Boundary boundary = Boundary::Torus;
+    int wordBits = 64;
+    int benchGenerations = 0;
+    int checkGenerations = 0;  // self-check: engines against each other, no window
+    bool sparse = false;
+    bool heat = false;
+    size_t hashlifeMemoryMb = HASHLIFE_DEFAULT_MEMORY_MB;
+    int threads = 1;
+    int stepExponent = 0;
+    std::string loadPath, savePath;  // Macrocell files, HashLife only
+    std::string publishName;  // POSIX shared memory name, e.g. /conway
+    std::string controlPath;  // Unix socket for remote commands
+    std::string trackPath;  // catalogue of still lifes, oscillators and spaceships, written at exit
+    bool pruneEscaping = false;
+    std::string agarPath;  // RLE of a periodic background, tiled engine only
+    Pacing pacing = { PacingMode::Vsync, 0 };
+    double simRate = 0;  // generations per second, 0 = unthrottled
+    bool simThread = false;  // step on a second thread and GL context, GPU engine only
+    int batch = 1;  // steps per submission
+    int benchDispatches = 0;  // generations for the GPU dispatch benchmark
+    bool query = false;
+    long long queryX = 0, queryY = 0;
+    int queryWidth = 0, queryHeight = 0;
+    unsigned long long queryGenerations = 0;
+    uint64_t seed = 1;  // of the initial soup
+    double density = 0.5;
+    std::string manifestPath;
+    std::string commandLine;
+    bool sweep = false;  // batch of random soups instead of the window
+    unsigned long long sweepFirst = 0, sweepLast = 0;
+    int sweepWidth = 256, sweepHeight = 256;
+    unsigned sweepGenerations = 10000;
+    std::string sweepPath = "sweep.lsw";
+    std::string sweepReport;  // sweep file to summarize
+};
 
 class GridVisualizer {
 private:
     GLFWwindow* window;
     GLuint computeProgram, renderProgram, textures[2], vao;
     GLuint currentTextureIdx;
+    Engine* engine;
+    GLubyte* engineCells;
+    HashLifeEngine* hashlife;  // engine, when it can take 2^k steps
+    bool engineLoaded;  // engine already holds a pattern from a file
+    std::atomic<unsigned long long> generation;
+    Rule rule;
+    std::atomic<bool> paused;
+    uint64_t seed;  // and density of the initial soup
+    double density;
 
-    const char* computeShaderSource = R"(
-        #version 430 core
-        layout(local_size_x = 16, local_size_y = 16, local_size_z = 1) in;
-        layout(r8, binding = 0) uniform readonly image2D currentGrid;
-        layout(r8, binding = 1) uniform writeonly image2D nextGrid;
-        void main() {
-            ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
-            ivec2 size = imageSize(currentGrid);
-            if (pos.x >= size.x || pos.y >= size.y) return;
-            float current = imageLoad(currentGrid, pos).r;
-            int liveNeighbors = 0;
-            for (int dy = -1; dy <= 1; dy++) {
-                for (int dx = -1; dx <= 1; dx++) {
-                    if (dx == 0 && dy == 0) continue;
-                    ivec2 neighborPos = (pos + ivec2(dx, dy) + size) % size;
-                    liveNeighbors += imageLoad(currentGrid, neighborPos).r > 0.5 ? 1 : 0;
-                }
-            }
-            float nextState = 0.0;
-            if (current > 0.5) {
-                nextState = (liveNeighbors == 2 || liveNeighbors == 3) ? 1.0 : 0.0;
-            } else {
-                nextState = (liveNeighbors == 3) ? 1.0 : 0.0;
-            }
-            imageStore(nextGrid, pos, vec4(nextState, 0.0, 0.0, 1.0));
-        }
-    )";
+    // Editing. Drawn cells queue up in pendingEdits and reach the grid once
+    // per frame, before the next step: on the GPU path as one scatter
+    // dispatch, on a CPU engine as a single store/patch/load.
+    std::vector<GLuint> pendingEdits;
+    std::mutex editMutex;
+    unsigned long long pendingSteps;  // left of a control "step N", answered when 0
+    int pendingExponent;  // HashLife step exponent the pending steps were counted in
+    GLuint editProgram, editBuffer;
+    bool drawing, selecting, hasSelection;
+    GLubyte drawValue;
+    int lastCellX, lastCellY;
+    int selection[4];  // anchor x, y and opposite corner x, y, both inclusive
+
+    // Frames for external readers. The GPU path reads the grid back through
+    // two pixel pack buffers and publishes each one a frame late, so mapping
+    // it never waits on the step that produced it.
+    ShmPublisher* publisher;
+    GLuint readbackBuffers[2];
+    unsigned long long readbackGenerations[2];  // generation each buffer was read at
+    int readbackIdx;
+    bool readbackPending;
+
+    // Object tracking reads every generation back synchronously; it is an
+    // analysis mode, not a fast one.
+    ObjectTracker* tracker;
+    std::vector<GLubyte> trackCells;
+    bool pruneEscaping;
+
+    // Sparse mode: only tiles listed in activeTilesBuffer are stepped, through
+    // glDispatchComputeIndirect on dispatchBuffer.
+    bool sparse;
+
+    // Heat mode: the step shader counts state changes per cell in an r8ui
+    // image that the fragment shader can show instead of the plain grid.
+    bool heat, showHeat;
+    GLuint heatTexture;
+
+    GLuint compactionProgram, activeTilesBuffer, changedTilesBuffer, dispatchBuffer;
+    GLuint tilesX, tilesY;
+
+    // Steps per computeStep: GPU dispatches back to back, or engine steps
+    // before a single store(), which lets the Vulkan engine submit them together.
+    int batch;
+    GLint parityLocation;
+
+    // Damage tracking. The window is drawn into canvasTexture, and a frame
+    // only redraws the rectangle that changed since the last one before
+    // blitting the canvas; with nothing damaged it is not drawn at all. The
+    // step shader grows one of two damageBuffers over the tiles it changed,
+    // CPU engines diff against shownCells, the copy that is in the texture.
+    // The GPU rectangle is read a frame late through a persistent mapping
+    // once its fence has signalled, so a frame never waits on the GPU.
+    int damage[4];  // x0, y0, x1, y1, exclusive; empty when x1 <= x0
+    GLuint damageBuffers[2], canvasFramebuffer, canvasTexture;
+    GLint* damageMaps[2];
+    GLsync damageFences[2];
+    int damageIdx;  // buffer the steps grow
+    bool gpuDamagePending;  // damageBuffers[damageIdx] has been written
+    std::vector<GLubyte> shownCells;
+    std::mutex damageMutex;
+
+    // Simulation thread. Steps, edits and control commands run on the
+    // context of the hidden simWindow, which shares objects with the window's
+    // own context; the main thread only handles events and presents, so a
+    // slow swap never holds up a dispatch. Each new state is copied into
+    // whichever of the two presentTextures is not on screen and handed over
+    // with a fence that the render side waits on in the GPU, not the CPU.
+    // readFences tell the simulation when the render side is done sampling a
+    // texture it is about to overwrite. UI actions that touch the grid go to
+    // the simulation as tasks, and results for GLFW come back the same way.
+    GLFWwindow* simWindow;
+    std::thread simulation;
+    std::atomic<bool> simRunning;
+    bool presentStale;  // the grid changed since the last handoff
+    GLuint presentTextures[2], presentHeat[2];
+    std::mutex handoffMutex;
+    GLsync handoffFence, readFences[2];
+    int handoffSlot, displayedSlot;
+    std::mutex taskMutex;
+    std::vector<std::function<void()>> simTasks, mainTasks;
 
     const char* vertexShaderSource = R"(
         #version 330 core
@@ -56,9 +192,24 @@ private:
         in vec2 TexCoord;
         out vec4 FragColor;
         uniform sampler2D gridTexture;
+        uniform usampler2D heatTexture;
+        uniform bool showHeat;
+        uniform ivec4 selection;  // x0, y0, x1, y1 in cells, empty when x1 <= x0
         void main() {
-            float value = texture(gridTexture, TexCoord).r;
+            // Row 0 of the grid is the top of the window, as in RLE and cursor coordinates.
+            vec2 uv = vec2(TexCoord.x, 1.0 - TexCoord.y);
+            float value = texture(gridTexture, uv).r;
             FragColor = vec4(value, value, value, 1.0);
+            if (showHeat) {
+                // Black through red and yellow to white; sqrt spreads out the low counts.
+                float heat = sqrt(float(texture(heatTexture, uv).r) / 255.0);
+                vec3 ramp = clamp(vec3(3.0 * heat, 3.0 * heat - 1.0, 3.0 * heat - 2.0), 0.0, 1.0);
+                FragColor.rgb = max(ramp, vec3(value * 0.5));
+            }
+            ivec2 cell = ivec2(uv * vec2(textureSize(gridTexture, 0)));
+            if (all(greaterThanEqual(cell, selection.xy)) && all(lessThan(cell, selection.zw))) {
+                FragColor.rgb = mix(FragColor.rgb, vec3(0.2, 0.4, 1.0), 0.35);
+            }
         }
     )";
 
@@ -91,8 +242,8 @@ private:
         return program;
     }
 
-    GLuint createComputeProgram() {
-        GLuint shader = createShader(GL_COMPUTE_SHADER, computeShaderSource);
+    GLuint createComputeProgram(const std::string& source) {
+        GLuint shader = createShader(GL_COMPUTE_SHADER, source.c_str());
         GLuint program = glCreateProgram();
         glAttachShader(program, shader);
         glLinkProgram(program);
@@ -107,8 +258,329 @@ private:
         return program;
     }
 
+    void createTileBuffers() {
+        GLuint tileCount = tilesX * tilesY;
+        std::vector<GLuint> noneChanged(tileCount, 0);
+
+        glGenBuffers(1, &activeTilesBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, activeTilesBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, tileCount * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+        glGenBuffers(1, &changedTilesBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, changedTilesBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, tileCount * sizeof(GLuint), noneChanged.data(), GL_DYNAMIC_COPY);
+        glGenBuffers(1, &dispatchBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, dispatchBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, 3 * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+        activateAllTiles();
+        GLenum err = glGetError();
+        if (err != GL_NO_ERROR) {
+            std::cerr << "Tile buffer creation error: " << err << "\n";
+        }
+    }
+
+    // '+' and '-' change the HashLife step exponent between frames. Space
+    // pauses; Ctrl+C / Ctrl+V copy the selection to and paste RLE from the
+    // clipboard, and Delete clears the selection.
+    static void keyCallback(GLFWwindow* window, int key, int /*scancode*/, int action, int mods) {
+        GridVisualizer* viz = static_cast<GridVisualizer*>(glfwGetWindowUserPointer(window));
+        if (action == GLFW_RELEASE) return;
+        if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) viz->paused = !viz->paused;
+        if (key == GLFW_KEY_C && (mods & GLFW_MOD_CONTROL)) viz->copySelection();
+        if (key == GLFW_KEY_V && (mods & GLFW_MOD_CONTROL)) viz->pasteAtCursor();
+        if (key == GLFW_KEY_DELETE) viz->clearSelection();
+        if (key == GLFW_KEY_H && viz->heat) {
+            if (mods & GLFW_MOD_CONTROL) viz->onSimulation([viz] { viz->clearHeat(); });
+            else if (action == GLFW_PRESS) viz->showHeat = !viz->showHeat;
+            viz->damageAll();
+        }
+        if (viz->hashlife) {
+            int exponent = viz->hashlife->currentStepExponent();
+            if (key == GLFW_KEY_EQUAL) viz->hashlife->setStepExponent(exponent + 1);
+            if (key == GLFW_KEY_MINUS) viz->hashlife->setStepExponent(exponent - 1);
+        }
+        viz->updateTitle();
+    }
+
+    // Left button draws, right button erases, Shift + left drags a selection
+    // and Ctrl + left selects the object under the cursor.
+    static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+        GridVisualizer* viz = static_cast<GridVisualizer*>(glfwGetWindowUserPointer(window));
+        int x, y;
+        viz->cursorCell(x, y);
+        if (action == GLFW_RELEASE) {
+            viz->drawing = viz->selecting = false;
+            return;
+        }
+        if (button == GLFW_MOUSE_BUTTON_LEFT && (mods & GLFW_MOD_CONTROL)) {
+            viz->selectObjectAt(x, y);
+        } else if (button == GLFW_MOUSE_BUTTON_LEFT && (mods & GLFW_MOD_SHIFT)) {
+            viz->selecting = viz->hasSelection = true;
+            viz->selection[0] = viz->selection[2] = x;
+            viz->selection[1] = viz->selection[3] = y;
+            viz->damageAll();
+        } else if (button == GLFW_MOUSE_BUTTON_LEFT || button == GLFW_MOUSE_BUTTON_RIGHT) {
+            viz->drawing = true;
+            viz->drawValue = button == GLFW_MOUSE_BUTTON_LEFT ? 255 : 0;
+            viz->lastCellX = x;
+            viz->lastCellY = y;
+            viz->queueEdit(x, y, viz->drawValue);
+        }
+    }
+
+    static void cursorPosCallback(GLFWwindow* window, double, double) {
+        GridVisualizer* viz = static_cast<GridVisualizer*>(glfwGetWindowUserPointer(window));
+        int x, y;
+        viz->cursorCell(x, y);
+        if (viz->selecting && (viz->selection[2] != x || viz->selection[3] != y)) {
+            viz->selection[2] = x;
+            viz->selection[3] = y;
+            viz->damageAll();
+        }
+        if (!viz->drawing) return;
+        // Bresenham from the last sample, so fast strokes stay connected.
+        int dx = abs(x - viz->lastCellX), dy = -abs(y - viz->lastCellY);
+        int sx = x > viz->lastCellX ? 1 : -1, sy = y > viz->lastCellY ? 1 : -1, error = dx + dy;
+        for (int cx = viz->lastCellX, cy = viz->lastCellY; cx != x || cy != y;) {
+            int e2 = 2 * error;
+            if (e2 >= dy) { error += dy; cx += sx; }
+            if (e2 <= dx) { error += dx; cy += sy; }
+            viz->queueEdit(cx, cy, viz->drawValue);
+        }
+        viz->lastCellX = x;
+        viz->lastCellY = y;
+    }
+
+    void clearHeat() {
+        std::vector<GLubyte> zeros(WIDTH * HEIGHT, 0);
+        glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+        glBindTexture(GL_TEXTURE_2D, heatTexture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, WIDTH, HEIGHT, GL_RED_INTEGER, GL_UNSIGNED_BYTE, zeros.data());
+        presentStale = true;
+        damageAll();
+    }
+
+    // Runs a task on the thread that owns the simulation's GL context, or
+    // right away without a simulation thread.
+    void onSimulation(std::function<void()> task) {
+        if (!simWindow) { task(); return; }
+        std::lock_guard<std::mutex> lock(taskMutex);
+        simTasks.push_back(std::move(task));
+    }
+
+    // Runs a task on the main thread, where GLFW calls and the selection live.
+    void onMain(std::function<void()> task) {
+        if (!simWindow) { task(); return; }
+        {
+            std::lock_guard<std::mutex> lock(taskMutex);
+            mainTasks.push_back(std::move(task));
+        }
+        glfwPostEmptyEvent();
+    }
+
+    void runTasks(std::vector<std::function<void()>>& tasks) {
+        std::vector<std::function<void()>> ready;
+        {
+            std::lock_guard<std::mutex> lock(taskMutex);
+            ready.swap(tasks);
+        }
+        for (auto& task : ready) task();
+    }
+
+    static void refreshCallback(GLFWwindow* window) {
+        static_cast<GridVisualizer*>(glfwGetWindowUserPointer(window))->damageAll();
+    }
+
+    void addDamage(int x0, int y0, int x1, int y1) {
+        if (x0 >= x1 || y0 >= y1) return;
+        std::lock_guard<std::mutex> lock(damageMutex);
+        if (damage[2] <= damage[0]) {
+            damage[0] = x0; damage[1] = y0; damage[2] = x1; damage[3] = y1;
+            return;
+        }
+        damage[0] = std::min(damage[0], x0);
+        damage[1] = std::min(damage[1], y0);
+        damage[2] = std::max(damage[2], x1);
+        damage[3] = std::max(damage[3], y1);
+    }
+
+    void damageAll() { addDamage(0, 0, WIDTH, HEIGHT); }
+
+    // Only for a buffer the GPU is done with; the mapping is coherent, so
+    // later dispatches see the reset.
+    void resetGpuDamage(int idx) {
+        GLint* rect = damageMaps[idx];
+        rect[0] = rect[1] = INT_MAX;
+        rect[2] = rect[3] = INT_MIN;
+    }
+
+    // Reads the rectangle fenced at the previous frame, if the GPU is done
+    // with it, and fences the one the steps since have grown. While the old
+    // fence is still pending the frame redraws everything instead and the
+    // steps keep growing the current buffer.
+    void collectGpuDamage() {
+        int other = 1 - damageIdx;
+        if (damageFences[other]) {
+            if (glClientWaitSync(damageFences[other], 0, 0) == GL_TIMEOUT_EXPIRED) {
+                damageAll();
+                return;
+            }
+            glDeleteSync(damageFences[other]);
+            damageFences[other] = 0;
+            const GLint* rect = damageMaps[other];
+            addDamage(rect[0], rect[1], rect[2], rect[3]);
+            resetGpuDamage(other);
+        }
+        if (!gpuDamagePending) return;
+        glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+        damageFences[damageIdx] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        damageIdx = other;
+        gpuDamagePending = false;
+    }
+
+    // Uploads the part of engineCells that differs from shownCells and marks it damaged.
+    void uploadEngineCells() {
+        int x0 = WIDTH, y0 = HEIGHT, x1 = 0, y1 = 0;
+        for (int y = 0; y < HEIGHT; y++) {
+            const GLubyte* now = engineCells + size_t(y) * WIDTH;
+            GLubyte* shown = &shownCells[size_t(y) * WIDTH];
+            if (memcmp(now, shown, WIDTH) == 0) continue;
+            int first = 0, last = WIDTH - 1;
+            while (now[first] == shown[first]) first++;
+            while (now[last] == shown[last]) last--;
+            memcpy(shown + first, now + first, last - first + 1);
+            x0 = std::min(x0, first);
+            x1 = std::max(x1, last + 1);
+            y0 = std::min(y0, y);
+            y1 = y + 1;
+        }
+        if (x0 >= x1) return;
+        glBindTexture(GL_TEXTURE_2D, textures[currentTextureIdx]);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, WIDTH);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x0, y0, x1 - x0, y1 - y0, GL_RED, GL_UNSIGNED_BYTE, engineCells + size_t(y0) * WIDTH + x0);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        addDamage(x0, y0, x1, y1);
+    }
+
+    void cursorCell(int& x, int& y) {
+        double cx, cy;
+        int windowWidth, windowHeight;
+        glfwGetCursorPos(window, &cx, &cy);
+        glfwGetWindowSize(window, &windowWidth, &windowHeight);
+        x = std::max(0, std::min(WIDTH - 1, int(cx * WIDTH / std::max(windowWidth, 1))));
+        y = std::max(0, std::min(HEIGHT - 1, int(cy * HEIGHT / std::max(windowHeight, 1))));
+    }
+
+    void queueEdit(int x, int y, GLubyte value) {
+        if (x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT) return;
+        std::lock_guard<std::mutex> lock(editMutex);
+        pendingEdits.push_back(GLuint(x) | (GLuint(y) << EDIT_COORD_BITS) | (value ? 1u << 31 : 0u));
+    }
+
+    bool selectionRect(int& x, int& y, int& w, int& h) const {
+        x = std::min(selection[0], selection[2]);
+        y = std::min(selection[1], selection[3]);
+        w = abs(selection[2] - selection[0]) + 1;
+        h = abs(selection[3] - selection[1]) + 1;
+        return hasSelection;
+    }
+
+    void copySelection() {
+        int x, y, w, h;
+        if (!selectionRect(x, y, w, h)) return;
+        onSimulation([this, x, y, w, h] {
+            std::vector<GLubyte> cells(WIDTH * HEIGHT), region(size_t(w) * h);
+            readGrid(cells.data());
+            for (int row = 0; row < h; row++) memcpy(&region[size_t(row) * w], &cells[size_t(y + row) * WIDTH + x], w);
+            std::string text = writeRle(region.data(), w, h, rule);
+            onMain([this, text] { glfwSetClipboardString(window, text.c_str()); });
+        });
+    }
+
+    // Selects the bounding box of the object (8-connected live cells) under the cursor.
+    void selectObjectAt(int x, int y) {
+        onSimulation([this, x, y] {
+            std::vector<GLubyte> cells(WIDTH * HEIGHT);
+            readGrid(cells.data());
+            if (!cells[size_t(y) * WIDTH + x]) return;
+            std::vector<uint64_t> words(size_t((WIDTH + 63) / 64) * HEIGHT);
+            packCells(cells.data(), WIDTH, HEIGHT, words.data());
+            ComponentLabeler labeler(WIDTH, HEIGHT);
+            std::vector<Component> components;
+            labeler.label(words.data(), nullptr, components);
+            Component c = components[labeler.componentAt(x, y)];
+            onMain([this, c] {
+                hasSelection = true;
+                selection[0] = c.x0;
+                selection[1] = c.y0;
+                selection[2] = c.x1;
+                selection[3] = c.y1;
+                damageAll();
+            });
+        });
+    }
+
+    void pasteAtCursor() {
+        const char* text = glfwGetClipboardString(window);
+        RlePattern pattern;
+        if (!text || !parseRle(text, pattern)) { std::cerr << "Clipboard holds no RLE pattern\n"; return; }
+        int x, y;
+        cursorCell(x, y);
+        onSimulation([this, x, y, pattern] {
+            applyEdits();
+            writeCells(x, y, pattern.width, pattern.height, pattern.cells.data());
+        });
+    }
+
+    void clearSelection() {
+        int x, y, w, h;
+        if (!selectionRect(x, y, w, h)) return;
+        onSimulation([this, x, y, w, h] {
+            std::vector<GLubyte> empty(size_t(w) * h, 0);
+            applyEdits();
+            writeCells(x, y, w, h, empty.data());
+        });
+    }
+
+    void updateTitle() {
+        std::string title = "Conway's Game of Life - generation " + std::to_string(generation);
+        if (hashlife) title += " (step 2^" + std::to_string(hashlife->currentStepExponent()) + ")";
+        glfwSetWindowTitle(window, title.c_str());
+    }
+
+    // Puts every tile on the active list, for the first step and after cells
+    // were written from outside the step shader.
+    void activateAllTiles() {
+        GLuint tileCount = tilesX * tilesY;
+        std::vector<GLuint> allTiles(tileCount);
+        for (GLuint i = 0; i < tileCount; i++) allTiles[i] = i;
+        GLuint fullDispatch[3] = { tileCount, 1, 1 };
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, activeTilesBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, tileCount * sizeof(GLuint), allTiles.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, dispatchBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(fullDispatch), fullDispatch);
+    }
+
+    GLuint activeTileCount() {
+        GLuint count = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, dispatchBuffer);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &count);
+        return count;
+    }
+
 public:
-    GridVisualizer() {
+    GridVisualizer(const Options& options, Engine* engine)
+        : engine(engine), engineCells(nullptr), hashlife(dynamic_cast<HashLifeEngine*>(engine)),
+          engineLoaded(engine && !options.loadPath.empty()), generation(0), rule(options.rule), paused(false),
+          seed(options.seed), density(options.density),
+          pendingSteps(0), pendingExponent(0), editProgram(0), editBuffer(0), drawing(false), selecting(false), hasSelection(false), drawValue(0),
+          lastCellX(0), lastCellY(0), selection(), publisher(nullptr),
+          readbackIdx(0), readbackPending(false), tracker(nullptr),
+          pruneEscaping(options.pruneEscaping), damage(), damageBuffers(), canvasFramebuffer(0), canvasTexture(0),
+          damageMaps(), damageFences(), damageIdx(0),
+          gpuDamagePending(false), simWindow(nullptr), simRunning(false), presentStale(true), presentTextures(), presentHeat(),
+          handoffFence(0), readFences(), handoffSlot(0), displayedSlot(1) {
         if (!glfwInit()) { std::cerr << "GLFW init failed\n"; return; }
         glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
         glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -117,17 +589,57 @@ public:
         window = glfwCreateWindow(WIDTH, HEIGHT, "Conway's Game of Life", NULL, NULL);
         if (!window) { std::cerr << "Window creation failed\n"; glfwTerminate(); return; }
         glfwMakeContextCurrent(window);
+        glfwSetWindowUserPointer(window, this);
+        glfwSetKeyCallback(window, keyCallback);
+        glfwSetMouseButtonCallback(window, mouseButtonCallback);
+        glfwSetCursorPosCallback(window, cursorPosCallback);
+        glfwSetWindowRefreshCallback(window, refreshCallback);
+        int interval = swapInterval(options.pacing);
+        if (interval < 0 && !glfwExtensionSupported("WGL_EXT_swap_control_tear") && !glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+            std::cerr << "Adaptive vsync is not supported, using vsync\n";
+            interval = 1;
+        }
+        glfwSwapInterval(interval);
         if (glewInit() != GLEW_OK) { std::cerr << "GLEW init failed\n"; return; }
 
         glViewport(0, 0, WIDTH, HEIGHT);
 
+        if (options.simThread && engine) std::cerr << "The simulation thread needs the GPU engine\n";
+        if (options.simThread && !engine) {
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            simWindow = glfwCreateWindow(1, 1, "", NULL, window);
+            if (!simWindow) std::cerr << "Could not create the simulation context, stepping on the main thread\n";
+        }
+
         GLuint vertexShader = createShader(GL_VERTEX_SHADER, vertexShaderSource);
         GLuint fragmentShader = createShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
         renderProgram = createProgram(vertexShader, fragmentShader);
         glDeleteShader(vertexShader);
         glDeleteShader(fragmentShader);
 
-        computeProgram = createComputeProgram();
+        sparse = options.sparse && !engine;
+        tilesX = (WIDTH + GPU_TILE - 1) / GPU_TILE;
+        tilesY = (HEIGHT + GPU_TILE - 1) / GPU_TILE;
+        heat = showHeat = options.heat && !engine;
+        if (options.heat && engine) std::cerr << "Heat map needs the GPU engine\n";
+        computeProgram = createComputeProgram(lifeComputeShader({ options.rule, options.boundary, sparse, heat, !engine && !simWindow }));
+        parityLocation = glGetUniformLocation(computeProgram, "parity");
+        batch = options.batch;
+        if (batch > 1 && (!options.trackPath.empty() || pruneEscaping)) {
+            std::cerr << "Object tracking needs every generation, stepping one at a time\n";
+            batch = 1;
+        }
+        compactionProgram = activeTilesBuffer = changedTilesBuffer = dispatchBuffer = 0;
+        if (sparse) {
+            compactionProgram = createComputeProgram(tileCompactionShader(options.boundary));
+            glUseProgram(compactionProgram);
+            glUniform2i(glGetUniformLocation(compactionProgram, "tiles"), tilesX, tilesY);
+            createTileBuffers();
+        }
+        if (!engine) {
+            editProgram = createComputeProgram(editScatterShader());
+            glGenBuffers(1, &editBuffer);
+        }
 
         glGenTextures(2, textures);
         for (int i = 0; i < 2; i++) {
@@ -141,10 +653,72 @@ public:
             }
         }
         currentTextureIdx = 0;
+        heatTexture = 0;
+        if (heat) {
+            glGenTextures(1, &heatTexture);
+            glBindTexture(GL_TEXTURE_2D, heatTexture);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, WIDTH, HEIGHT, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            clearHeat();
+        }
 
         glGenVertexArrays(1, &vao);
         glBindVertexArray(vao);
 
+        if (simWindow) {
+            glGenTextures(2, presentTextures);
+            if (heat) glGenTextures(2, presentHeat);
+            for (int i = 0; i < 2; i++) {
+                glBindTexture(GL_TEXTURE_2D, presentTextures[i]);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, WIDTH, HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                if (!heat) continue;
+                glBindTexture(GL_TEXTURE_2D, presentHeat[i]);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, WIDTH, HEIGHT, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, NULL);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            }
+        }
+
+        glGenTextures(1, &canvasTexture);
+        glBindTexture(GL_TEXTURE_2D, canvasTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, WIDTH, HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glGenFramebuffers(1, &canvasFramebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, canvasFramebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, canvasTexture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) std::cerr << "Canvas framebuffer incomplete\n";
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (!engine && !simWindow) {
+            GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glGenBuffers(2, damageBuffers);
+            for (int i = 0; i < 2; i++) {
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, damageBuffers[i]);
+                glBufferStorage(GL_SHADER_STORAGE_BUFFER, 4 * sizeof(GLint), NULL, flags);
+                damageMaps[i] = static_cast<GLint*>(glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, 4 * sizeof(GLint), flags));
+                resetGpuDamage(i);
+            }
+        }
+
+        if (!options.publishName.empty()) {
+            publisher = new ShmPublisher(options.publishName, WIDTH, HEIGHT, options.rule);
+            if (!publisher->ok()) { delete publisher; publisher = nullptr; }
+        }
+        if (!options.trackPath.empty() || pruneEscaping) {
+            tracker = new ObjectTracker(WIDTH, HEIGHT, options.rule, options.threads);
+            trackCells.resize(WIDTH * HEIGHT);
+        }
+        if (publisher && !engine) {
+            glGenBuffers(2, readbackBuffers);
+            for (int i = 0; i < 2; i++) {
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffers[i]);
+                glBufferData(GL_PIXEL_PACK_BUFFER, WIDTH * HEIGHT, NULL, GL_STREAM_READ);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        }
+
         glUseProgram(renderProgram);
         GLint loc = glGetUniformLocation(renderProgram, "gridTexture");
         if (loc != -1) {
@@ -159,11 +733,28 @@ public:
 
     void initializeGrid() {
         GLubyte* initialData = new GLubyte[WIDTH * HEIGHT];
-        for (int i = 0; i < WIDTH * HEIGHT; i++) {
-            initialData[i] = rand() % 2 ? 255 : 0;
+        TiledEngine* tiled = dynamic_cast<TiledEngine*>(engine);
+        if (engineLoaded) {
+            engine->store(initialData);
+        } else if (tiled && tiled->hasAgar()) {
+            // Random cells in a 64x64 square in the middle of the agar.
+            tiled->storeBackground(initialData);
+            Rng rng(seed);
+            for (int y = HEIGHT / 2 - 32; y < HEIGHT / 2 + 32; y++) {
+                for (int x = WIDTH / 2 - 32; x < WIDTH / 2 + 32; x++) initialData[y * WIDTH + x] = rng.chance(density) ? 255 : 0;
+            }
+            engine->load(initialData);
+        } else {
+            randomSoup(initialData, WIDTH * HEIGHT, density, seed);
+            if (engine) engine->load(initialData);
+        }
+        if (engine) {
+            engineCells = new GLubyte[WIDTH * HEIGHT];
+            shownCells.assign(initialData, initialData + WIDTH * HEIGHT);
         }
         glBindTexture(GL_TEXTURE_2D, textures[0]);
         glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, WIDTH, HEIGHT, GL_RED, GL_UNSIGNED_BYTE, initialData);
+        damageAll();
         GLenum err = glGetError();
         if (err != GL_NO_ERROR) {
             std::cerr << "Texture upload error: " << err << "\n";
@@ -181,28 +772,295 @@ public:
         delete[] checkData;
     }
 
-    void computeStep() {
-        glUseProgram(computeProgram);
-        glBindImageTexture(0, textures[currentTextureIdx], 0, GL_FALSE, 0, GL_READ_ONLY, GL_R8);
-        glBindImageTexture(1, textures[1 - currentTextureIdx], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8);
+    // Flushes the cells drawn since the last frame into the current generation.
+    void applyEdits() {
+        std::vector<GLuint> edits;
+        {
+            std::lock_guard<std::mutex> lock(editMutex);
+            edits.swap(pendingEdits);
+        }
+        if (edits.empty()) return;
+        presentStale = true;
+        if (hashlife) {
+            for (GLuint edit : edits) {
+                GLuint x = edit & ((1u << EDIT_COORD_BITS) - 1), y = (edit >> EDIT_COORD_BITS) & ((1u << EDIT_COORD_BITS) - 1);
+                GLubyte cell = edit >> 31 ? 255 : 0;
+                hashlife->setCells(x, y, 1, 1, &cell);
+            }
+            hashlife->store(engineCells);
+            uploadEngineCells();
+        } else if (engine) {
+            engine->store(engineCells);
+            for (GLuint edit : edits) {
+                GLuint x = edit & ((1u << EDIT_COORD_BITS) - 1), y = (edit >> EDIT_COORD_BITS) & ((1u << EDIT_COORD_BITS) - 1);
+                engineCells[y * WIDTH + x] = edit >> 31 ? 255 : 0;
+            }
+            engine->load(engineCells);
+            uploadEngineCells();
+        } else {
+            // Later edits of a cell win; the scatter pass writes in no particular order.
+            std::stable_sort(edits.begin(), edits.end(), [](GLuint a, GLuint b) { return (a & 0x7FFFFFFFu) < (b & 0x7FFFFFFFu); });
+            size_t count = 0;
+            for (size_t i = 0; i < edits.size(); i++) {
+                if (i + 1 < edits.size() && (edits[i] & 0x7FFFFFFFu) == (edits[i + 1] & 0x7FFFFFFFu)) continue;
+                edits[count++] = edits[i];
+                GLint x = edits[i] & ((1u << EDIT_COORD_BITS) - 1), y = (edits[i] >> EDIT_COORD_BITS) & ((1u << EDIT_COORD_BITS) - 1);
+                addDamage(x, y, x + 1, y + 1);
+            }
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, editBuffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, count * sizeof(GLuint), edits.data(), GL_STREAM_DRAW);
+            glUseProgram(editProgram);
+            glUniform1ui(glGetUniformLocation(editProgram, "editCount"), count);
+            glBindImageTexture(0, textures[currentTextureIdx], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R8);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, editBuffer);
+            glDispatchCompute((count + 63) / 64, 1, 1);
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+            if (sparse) activateAllTiles();
+        }
+    }
 
-        GLuint numGroupsX = (WIDTH + 15) / 16;
-        GLuint numGroupsY = (HEIGHT + 15) / 16;
-        glDispatchCompute(numGroupsX, numGroupsY, 1);
+    void computeStep() {
+        presentStale = true;
+        if (engine) {
+            for (int i = 0; i < batch; i++) engine->step();
+            generation += (hashlife ? 1ull << hashlife->currentStepExponent() : 1) * batch;
+            engine->store(engineCells);
+            uploadEngineCells();
+            if (publisher) publisher->publish(engineCells, generation);
+            if (tracker) trackGeneration();
+            return;
+        }
 
+        // Both textures stay bound for the whole batch and only the parity
+        // uniform changes between dispatches; errors are checked once at the end.
+        glUseProgram(computeProgram);
+        glBindImageTexture(0, textures[0], 0, GL_FALSE, 0, GL_READ_WRITE, GL_R8);
+        glBindImageTexture(1, textures[1], 0, GL_FALSE, 0, GL_READ_WRITE, GL_R8);
+        if (heat) glBindImageTexture(2, heatTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R8UI);
+        if (damageBuffers[0]) {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, damageBuffers[damageIdx]);
+            gpuDamagePending = true;
+        }
+        if (sparse) {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, activeTilesBuffer);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, changedTilesBuffer);
+            glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, dispatchBuffer);
+        }
+        for (int i = 0; i < batch; i++) {
+            if (sparse && i > 0) glUseProgram(computeProgram);
+            glUniform1ui(parityLocation, currentTextureIdx);
+            if (sparse) {
+                glDispatchComputeIndirect(0);
+                compactTiles();
+            } else {
+                glDispatchCompute((WIDTH + 15) / 16, (HEIGHT + 15) / 16, 1);
+            }
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            currentTextureIdx = 1 - currentTextureIdx;
+        }
         GLenum err = glGetError();
         if (err != GL_NO_ERROR) {
-            std::cout << "Compute: Reading from " << textures[currentTextureIdx] << ", Writing to " << textures[1 - currentTextureIdx] << "\n";
-            std::cerr << "Error after glDispatchCompute: " << err << "\n";
+            std::cerr << "Error after stepping " << batch << " generations: " << err << "\n";
+        }
+        generation += batch;
+        if (publisher) publishReadback();
+        if (tracker) trackGeneration();
+    }
+
+    // The tracker needs consecutive generations, so HashLife steps of more
+    // than one generation are not followed. Escaping ships are erased right
+    // away, before anything else can step the grid.
+    void trackGeneration() {
+        if (hashlife && hashlife->currentStepExponent() > 0) return;
+        readGrid(trackCells.data());
+        tracker->update(trackCells.data(), generation);
+        if (!pruneEscaping) return;
+        for (const TrackedObject* ship : tracker->escapingShips()) {
+            for (const auto& cell : tracker->objectCells(*ship)) queueEdit(cell.first, cell.second, 0);
+        }
+        applyEdits();
+    }
+
+    void writeCatalogue(std::ostream& out) const {
+        if (tracker) tracker->writeCatalogue(out);
+    }
+
+    void publishReadback() {
+        // The step wrote the texture with imageStore; the readback and the
+        // later map of the pack buffer both need those writes visible.
+        glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffers[readbackIdx]);
+        glBindTexture(GL_TEXTURE_2D, textures[currentTextureIdx]);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_UNSIGNED_BYTE, 0);
+        readbackGenerations[readbackIdx] = generation;
+        if (readbackPending) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackBuffers[1 - readbackIdx]);
+            void* cells = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, WIDTH * HEIGHT, GL_MAP_READ_BIT);
+            if (cells) {
+                publisher->publish(static_cast<const GLubyte*>(cells), readbackGenerations[1 - readbackIdx]);
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        readbackPending = true;
+        readbackIdx = 1 - readbackIdx;
+    }
+
+    // Rebuilds the active tile list from the changed flags the step just
+    // wrote. Tiles that were not stepped keep a zero flag from the last time
+    // they ran, so the flags never need clearing. Only the group count of the
+    // dispatch header is reset, on the GPU; the other two stay 1.
+    void compactTiles() {
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, dispatchBuffer);
+        glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, 0, sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+
+        glUseProgram(compactionProgram);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, dispatchBuffer);
+        glDispatchCompute((tilesX * tilesY + 63) / 64, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    }
+
+    // Copies the current state into the presentation texture that is not on
+    // screen and fences it. Returns false while the previous handoff has not
+    // been picked up, so copies happen at most once per presented frame.
+    bool handOff() {
+        int slot;
+        GLsync readDone;
+        {
+            std::lock_guard<std::mutex> lock(handoffMutex);
+            if (handoffFence) return false;
+            slot = 1 - displayedSlot;
+            readDone = readFences[slot];
+            readFences[slot] = 0;
+        }
+        if (readDone) {
+            glWaitSync(readDone, 0, GL_TIMEOUT_IGNORED);
+            glDeleteSync(readDone);
         }
+        glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+        glCopyImageSubData(textures[currentTextureIdx], GL_TEXTURE_2D, 0, 0, 0, 0, presentTextures[slot], GL_TEXTURE_2D, 0, 0, 0, 0, WIDTH, HEIGHT, 1);
+        if (heat) glCopyImageSubData(heatTexture, GL_TEXTURE_2D, 0, 0, 0, 0, presentHeat[slot], GL_TEXTURE_2D, 0, 0, 0, 0, WIDTH, HEIGHT, 1);
+        GLsync copied = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        {
+            std::lock_guard<std::mutex> lock(handoffMutex);
+            handoffFence = copied;
+            handoffSlot = slot;
+        }
+        glfwPostEmptyEvent();
+        return true;
+    }
+
+    // Switches the window to the last handed-off state, if there is a new one.
+    void takeHandoff() {
+        GLsync copied;
+        int slot;
+        {
+            std::lock_guard<std::mutex> lock(handoffMutex);
+            if (!handoffFence) return;
+            copied = handoffFence;
+            slot = handoffSlot;
+        }
+        // Covers every draw that sampled the texture going off screen.
+        GLsync readDone = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        glWaitSync(copied, 0, GL_TIMEOUT_IGNORED);
+        glDeleteSync(copied);
+        {
+            std::lock_guard<std::mutex> lock(handoffMutex);
+            readFences[displayedSlot] = readDone;
+            displayedSlot = slot;
+            handoffFence = 0;
+        }
+        damageAll();
+    }
 
-        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-        currentTextureIdx = 1 - currentTextureIdx;
+    bool threaded() const { return simWindow != nullptr; }
+
+    void startSimulation(ControlServer* control, double simRate) {
+        if (!simWindow) return;
+        handOff();
+        presentStale = false;
+        glFinish();
+        simRunning = true;
+        simulation = std::thread([this, control, simRate] { simulate(control, simRate); });
+    }
+
+    void stopSimulation() {
+        if (!simulation.joinable()) return;
+        simRunning = false;
+        simulation.join();
+    }
+
+    // Body of the simulation thread: steps on its own schedule and hands the
+    // newest state over whenever the render side has taken the last one.
+    void simulate(ControlServer* control, double simRate) {
+        glfwMakeContextCurrent(simWindow);
+        FramePacer pacer({ PacingMode::Unlimited, 0 }, simRate, 0);
+        while (simRunning) {
+            runTasks(simTasks);
+            if (control) applyCommands(*control);
+            applyEdits();
+            bool stepped = !paused && pacer.stepDue(glfwGetTime());
+            if (stepped) {
+                computeStep();
+                pacer.stepped(glfwGetTime());
+            }
+            if (presentStale && handOff()) presentStale = false;
+            if (!stepped) {
+                double idle = paused ? 0.002 : std::min(pacer.untilStep(glfwGetTime()), 0.002);
+                std::this_thread::sleep_for(std::chrono::duration<double>(idle));
+            }
+        }
+        glFinish();
+        glfwMakeContextCurrent(NULL);
+    }
+
+    void runMainTasks() { runTasks(mainTasks); }
+
+    // Steps the GPU grid the same number of generations one dispatch per
+    // computeStep and then as batches of up to BENCH_BATCH, and reports
+    // dispatches per second for both. glFinish brackets each run so only
+    // finished work is counted.
+    void benchmarkDispatches(int generations) {
+        int saved = batch;
+        for (int batched = 0; batched < 2; batched++) {
+            batch = batched ? std::min(generations, BENCH_BATCH) : 1;
+            glFinish();
+            double start = glfwGetTime();
+            int done = 0;
+            for (; done + batch <= generations; done += batch) computeStep();
+            glFinish();
+            double seconds = glfwGetTime() - start;
+            std::cout << (batched ? "batches of " + std::to_string(batch) : std::string("one per step")) << ": "
+                      << done / seconds << " dispatches/s (" << seconds * 1000 / done << " ms/gen)\n";
+        }
+        batch = saved;
     }
 
     void renderFrame() {
         if (!window) return;
-        glClear(GL_COLOR_BUFFER_BIT);
+        if (damageBuffers[0]) collectGpuDamage();
+        if (simWindow) takeHandoff();
+        int rect[4];
+        {
+            std::lock_guard<std::mutex> lock(damageMutex);
+            memcpy(rect, damage, sizeof(rect));
+            damage[0] = damage[1] = damage[2] = damage[3] = 0;
+        }
+        if (rect[2] <= rect[0]) {
+            // Nothing to redraw; a paused viewer sleeps until input instead of
+            // spinning, as does the main thread until the next handoff wakes it.
+            if (paused || simWindow) glfwWaitEventsTimeout(0.05);
+            else glfwPollEvents();
+            return;
+        }
+
+        // Grid row y is window row HEIGHT - 1 - y.
+        glBindFramebuffer(GL_FRAMEBUFFER, canvasFramebuffer);
+        glEnable(GL_SCISSOR_TEST);
+        glScissor(rect[0], HEIGHT - rect[3], rect[2] - rect[0], rect[3] - rect[1]);
 
         glUseProgram(renderProgram);
         GLenum err = glGetError();
@@ -212,8 +1070,9 @@ public:
 
         glBindVertexArray(vao);
 
+        GLuint grid = simWindow ? presentTextures[displayedSlot] : textures[currentTextureIdx];
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textures[currentTextureIdx]);
+        glBindTexture(GL_TEXTURE_2D, grid);
         GLint boundTexture;
         glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
 
@@ -222,25 +1081,50 @@ public:
         if (loc != -1) {
             glUniform1i(loc, 0);
         } else {
-            std::cout << "Render: Bound texture ID: " << boundTexture << " (expected " << textures[currentTextureIdx] << ")\n";
+            std::cout << "Render: Bound texture ID: " << boundTexture << " (expected " << grid << ")\n";
             std::cout << "gridTexture uniform location: " << loc << "\n";
             std::cerr << "gridTexture uniform not found (expected with red shader)\n";
         }
 
+        // The integer sampler must not share unit 0 with gridTexture, even when unused.
+        glUniform1i(glGetUniformLocation(renderProgram, "heatTexture"), 1);
+        glUniform1i(glGetUniformLocation(renderProgram, "showHeat"), showHeat);
+        if (heat) {
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, simWindow ? presentHeat[displayedSlot] : heatTexture);
+            glActiveTexture(GL_TEXTURE0);
+        }
+
+        int sx, sy, sw, sh;
+        if (selectionRect(sx, sy, sw, sh)) {
+            glUniform4i(glGetUniformLocation(renderProgram, "selection"), sx, sy, sx + sw, sy + sh);
+        } else {
+            glUniform4i(glGetUniformLocation(renderProgram, "selection"), 0, 0, 0, 0);
+        }
+
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
         err = glGetError();
         if (err != GL_NO_ERROR) {
             std::cerr << "Error after glDrawArrays: " << err << "\n";
         }
+        glDisable(GL_SCISSOR_TEST);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, canvasFramebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, WIDTH, HEIGHT, 0, 0, WIDTH, HEIGHT, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
         // FPS calculation
         static double lastTime = glfwGetTime();
         static int frameCount = 0;
+        static unsigned long long lastGeneration = generation;
         double currentTime = glfwGetTime();
         frameCount++;
         if (currentTime - lastTime >= 1.0) {
             float fps = frameCount / (currentTime - lastTime);
-            std::cout << "FPS: " << fps << "\n";
+            std::cout << "FPS: " << fps << ", generations/s: " << (generation - lastGeneration) / (currentTime - lastTime) << "\n";
+            lastGeneration = generation;
+            if (sparse) std::cout << "Active tiles: " << activeTileCount() << "/" << tilesX * tilesY << "\n";
+            updateTitle();
             frameCount = 0;
             lastTime = currentTime;
         }
@@ -249,31 +1133,675 @@ public:
         glfwPollEvents();
     }
 
+    // Current generation as one byte per cell, nonzero = alive.
+    void readGrid(GLubyte* cells) {
+        if (engine) {
+            engine->store(cells);
+            return;
+        }
+        glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+        glBindTexture(GL_TEXTURE_2D, textures[currentTextureIdx]);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_UNSIGNED_BYTE, cells);
+    }
+
+    // Overwrites a w x h rectangle of the current generation, clipped to the
+    // grid except on HashLife, which keeps the cells outside the window too.
+    // Returns false if HashLife cannot reach the rectangle.
+    bool writeCells(long long x, long long y, int w, int h, const GLubyte* cells) {
+        if (hashlife) {
+            presentStale = true;
+            if (!hashlife->setCells(x, y, w, h, cells)) return false;
+            hashlife->store(engineCells);
+            uploadEngineCells();
+            return true;
+        }
+        long long x0 = std::max(x, 0LL), y0 = std::max(y, 0LL);
+        long long x1 = std::min(x + w, (long long)WIDTH), y1 = std::min(y + h, (long long)HEIGHT);
+        if (x0 >= x1 || y0 >= y1) return true;
+        presentStale = true;
+        const GLubyte* first = cells + (y0 - y) * w + (x0 - x);
+        if (engine) {
+            engine->store(engineCells);
+            for (long long row = y0; row < y1; row++) {
+                memcpy(engineCells + row * WIDTH + x0, first + (row - y0) * w, x1 - x0);
+            }
+            engine->load(engineCells);
+            uploadEngineCells();
+            return true;
+        }
+        // The upload must land after the step shader's imageStores, not under them.
+        glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+        glBindTexture(GL_TEXTURE_2D, textures[currentTextureIdx]);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, w);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x0, y0, x1 - x0, y1 - y0, GL_RED, GL_UNSIGNED_BYTE, first);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        addDamage(x0, y0, x1, y1);
+        if (sparse) activateAllTiles();
+        return true;
+    }
+
+    // Applies queued control commands; called between generations. A step
+    // command only queues its steps: each call runs them for at most
+    // CONTROL_STEP_SECONDS and the reply goes out after the last one, so a
+    // long run never stalls frames or input. Later commands wait for it.
+    void applyCommands(ControlServer& control) {
+        ControlCommand command;
+        while (true) {
+            if (pendingSteps) {
+                runPendingSteps();
+                if (pendingSteps) return;
+                control.reply(true, "generation " + std::to_string(generation) + "\n");
+            }
+            if (!control.nextCommand(command)) return;
+            std::string reply;
+            bool success = runCommand(command, reply);
+            if (!pendingSteps) control.reply(success, reply);
+        }
+    }
+
+    // Whole batches, then the rest as one shorter batch, so exactly the
+    // queued number of steps is taken whatever --batch is. HashLife keeps the
+    // step size the command was converted with, even if '+' or '-' changed it.
+    void runPendingSteps() {
+        int full = batch, exponent = hashlife ? hashlife->currentStepExponent() : 0;
+        if (hashlife) hashlife->setStepExponent(pendingExponent);
+        double deadline = glfwGetTime() + CONTROL_STEP_SECONDS;
+        do {
+            batch = int(std::min<unsigned long long>(pendingSteps, full));
+            computeStep();
+            pendingSteps -= batch;
+        } while (pendingSteps && glfwGetTime() < deadline);
+        batch = full;
+        if (hashlife) hashlife->setStepExponent(exponent);
+    }
+
+    bool runCommand(const ControlCommand& command, std::string& reply) {
+        switch (command.op) {
+        case ControlOp::Step: {
+            // N counts generations; HashLife takes them 2^k at a time.
+            pendingExponent = hashlife ? hashlife->currentStepExponent() : 0;
+            unsigned long long perStep = 1ull << pendingExponent;
+            if (command.count % perStep) {
+                reply = "step count must be a multiple of 2^" + std::to_string(pendingExponent);
+                return false;
+            }
+            pendingSteps = command.count / perStep;
+            return true;
+        }
+        case ControlOp::Pause:
+        case ControlOp::Resume:
+            paused = command.op == ControlOp::Pause;
+            return true;
+        case ControlOp::Set: {
+            RlePattern pattern;
+            if (!parseRle(command.text, pattern)) { reply = "bad or oversized RLE"; return false; }
+            if (!writeCells(command.x, command.y, pattern.width, pattern.height, pattern.cells.data())) { reply = "position out of range"; return false; }
+            return true;
+        }
+        case ControlOp::Population: {
+            unsigned long long population = 0;
+            if (hashlife) {
+                population = hashlife->population();
+            } else {
+                std::vector<GLubyte> cells(WIDTH * HEIGHT);
+                readGrid(cells.data());
+                for (GLubyte cell : cells) population += cell != 0;
+            }
+            reply = "population " + std::to_string(population) + "\n";
+            return true;
+        }
+        case ControlOp::Region: {
+            if (!rleSizeOk(command.width, command.height)) { reply = "region too large"; return false; }
+            std::vector<GLubyte> region(size_t(command.width) * command.height, 0);
+            if (hashlife) {
+                hashlife->queryRegion(command.x, command.y, command.width, command.height, 0, region.data());
+            } else {
+                std::vector<GLubyte> cells(WIDTH * HEIGHT);
+                readGrid(cells.data());
+                for (int ry = 0; ry < command.height; ry++) {
+                    for (int rx = 0; rx < command.width; rx++) {
+                        long long gx = command.x + rx, gy = command.y + ry;
+                        if (gx >= 0 && gy >= 0 && gx < WIDTH && gy < HEIGHT) region[ry * command.width + rx] = cells[gy * WIDTH + gx];
+                    }
+                }
+            }
+            reply = writeRle(region.data(), command.width, command.height, rule);
+            return true;
+        }
+        case ControlOp::Checkpoint: {
+            std::ofstream out(command.text);
+            if (hashlife) {
+                hashlife->writeMacrocell(out);
+            } else {
+                std::vector<GLubyte> cells(WIDTH * HEIGHT);
+                readGrid(cells.data());
+                out << "#C generation " << generation << "\n" << writeRle(cells.data(), WIDTH, HEIGHT, rule);
+            }
+            if (!out) { reply = "could not write " + command.text; return false; }
+            return true;
+        }
+        }
+        return false;
+    }
+
+    bool isPaused() const { return paused; }
+
+    double refreshRate() const {
+        const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+        return mode ? mode->refreshRate : 60;
+    }
+
+    void waitEvents(double seconds) {
+        if (seconds > 0) glfwWaitEventsTimeout(seconds);
+    }
+
     bool isWindowOpen() {
         return window && !glfwWindowShouldClose(window);
     }
 
     void cleanup() {
+        stopSimulation();
         if (window) {
+            if (simWindow) {
+                glDeleteTextures(2, presentTextures);
+                if (heat) glDeleteTextures(2, presentHeat);
+                glDeleteSync(handoffFence);
+                for (GLsync fence : readFences) glDeleteSync(fence);
+                glfwDestroyWindow(simWindow);
+            }
             glDeleteVertexArrays(1, &vao);
             glDeleteTextures(2, textures);
+            if (heat) glDeleteTextures(1, &heatTexture);
+            glDeleteFramebuffers(1, &canvasFramebuffer);
+            glDeleteTextures(1, &canvasTexture);
+            if (damageBuffers[0]) {
+                for (GLsync fence : damageFences) if (fence) glDeleteSync(fence);
+                glDeleteBuffers(2, damageBuffers);
+            }
             glDeleteProgram(computeProgram);
+            if (sparse) {
+                glDeleteProgram(compactionProgram);
+                GLuint buffers[3] = { activeTilesBuffer, changedTilesBuffer, dispatchBuffer };
+                glDeleteBuffers(3, buffers);
+            }
+            if (publisher && !engine) glDeleteBuffers(2, readbackBuffers);
+            if (!engine) {
+                glDeleteProgram(editProgram);
+                glDeleteBuffers(1, &editBuffer);
+            }
             glDeleteProgram(renderProgram);
             glfwDestroyWindow(window);
             glfwTerminate();
         }
+        delete publisher;
+        publisher = nullptr;
+        delete tracker;
+        tracker = nullptr;
+        delete[] engineCells;
+        engineCells = nullptr;
     }
 };
 
-int main() {
-    GridVisualizer viz;
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 0; i < argc; i++) options.commandLine += (i ? " " : "") + std::string(argv[i]);
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = strchr(arg, '=');
+        std::string key = value ? std::string(arg, value - arg) : std::string(arg);
+        value = value ? value + 1 : "";
+        if (key == "--engine") {
+            options.engine = value;
+        } else if (key == "--rule") {
+            if (!parseRule(value, options.rule)) { std::cerr << "Bad rule: " << value << "\n"; return false; }
+        } else if (key == "--boundary") {
+            if (!parseBoundary(value, options.boundary)) { std::cerr << "Bad boundary: " << value << "\n"; return false; }
+        } else if (key == "--bench") {
+            options.benchGenerations = atoi(value);
+        } else if (key == "--check") {
+            options.checkGenerations = atoi(value);
+            if (options.checkGenerations < 1) { std::cerr << "Check needs at least 1 generation\n"; return false; }
+        } else if (key == "--hashlife-memory") {
+            options.hashlifeMemoryMb = strtoull(value, nullptr, 10);
+        } else if (key == "--control") {
+            options.controlPath = value;
+        } else if (key == "--publish") {
+            options.publishName = value;
+        } else if (key == "--load") {
+            options.loadPath = value;
+        } else if (key == "--save") {
+            options.savePath = value;
+        } else if (key == "--track") {
+            options.trackPath = value;
+            if (options.trackPath.empty()) { std::cerr << "--track needs a file name\n"; return false; }
+        } else if (key == "--prune-escaping") {
+            options.pruneEscaping = true;
+        } else if (key == "--agar") {
+            options.agarPath = value;
+        } else if (key == "--pacing") {
+            if (!parsePacing(value, options.pacing)) { std::cerr << "Pacing must be unlimited, vsync, adaptive or a frame rate\n"; return false; }
+        } else if (key == "--sim-rate") {
+            options.simRate = atof(value);
+            if (options.simRate < 0) { std::cerr << "Simulation rate must not be negative\n"; return false; }
+        } else if (key == "--batch") {
+            options.batch = atoi(value);
+            if (options.batch < 1) { std::cerr << "Batch must be at least 1\n"; return false; }
+        } else if (key == "--bench-dispatch") {
+            options.benchDispatches = atoi(value);
+        } else if (key == "--sim-thread") {
+            options.simThread = true;
+        } else if (key == "--step") {
+            options.stepExponent = atoi(value);
+        } else if (key == "--threads") {
+            options.threads = atoi(value);
+            if (options.threads < 1) { std::cerr << "Thread count must be at least 1\n"; return false; }
+        } else if (key == "--query") {
+            options.query = sscanf(value, "%lld,%lld,%d,%d,%llu", &options.queryX, &options.queryY,
+                                   &options.queryWidth, &options.queryHeight, &options.queryGenerations) == 5;
+            if (!options.query || options.queryWidth <= 0 || options.queryHeight <= 0) { std::cerr << "Query must be x,y,w,h,generations\n"; return false; }
+        } else if (key == "--seed") {
+            options.seed = strtoull(value, nullptr, 10);
+        } else if (key == "--manifest") {
+            options.manifestPath = value;
+        } else if (key == "--sweep") {
+            options.sweep = sscanf(value, "%llu,%llu", &options.sweepFirst, &options.sweepLast) == 2;
+            if (!options.sweep || options.sweepLast < options.sweepFirst) { std::cerr << "Sweep must be first,last seed\n"; return false; }
+        } else if (key == "--density") {
+            options.density = atof(value);
+            if (options.density < 0 || options.density > 1) { std::cerr << "Density must be between 0 and 1\n"; return false; }
+        } else if (key == "--sweep-size") {
+            if (sscanf(value, "%dx%d", &options.sweepWidth, &options.sweepHeight) != 2 || options.sweepWidth <= 0 || options.sweepHeight <= 0) {
+                std::cerr << "Sweep size must be WxH\n";
+                return false;
+            }
+        } else if (key == "--sweep-generations") {
+            options.sweepGenerations = strtoul(value, nullptr, 10);
+        } else if (key == "--sweep-file") {
+            options.sweepPath = value;
+        } else if (key == "--sweep-report") {
+            options.sweepReport = value;
+        } else if (key == "--heat") {
+            options.heat = true;
+        } else if (key == "--sparse") {
+            options.sparse = true;
+        } else if (key == "--word") {
+            options.wordBits = atoi(value);
+            if (options.wordBits != 32 && options.wordBits != 64) { std::cerr << "Word width must be 32 or 64\n"; return false; }
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string jsonString(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        if ((unsigned char)c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+// Everything that decides the cells of a run, so a result can be reproduced
+// and two runs compared on bit-identical input.
+bool writeManifest(const Options& options, const std::string& path) {
+    std::ofstream out(path);
+    bool sweep = options.sweep;
+    out << "{\n"
+        << "  \"command\": " << jsonString(options.commandLine) << ",\n"
+        << "  \"engine\": " << jsonString(sweep ? "tiled" : options.engine) << ",\n"
+        << "  \"rule\": " << jsonString(ruleString(options.rule)) << ",\n"
+        << "  \"boundary\": " << jsonString(boundaryName(options.boundary)) << ",\n"
+        << "  \"width\": " << (sweep ? options.sweepWidth : WIDTH) << ",\n"
+        << "  \"height\": " << (sweep ? options.sweepHeight : HEIGHT) << ",\n";
+    if (sweep) out << "  \"seeds\": [" << options.sweepFirst << ", " << options.sweepLast << "],\n";
+    else out << "  \"seed\": " << options.seed << ",\n";
+    // Enough digits that the density reads back as the same double.
+    out << "  \"density\": " << std::setprecision(std::numeric_limits<double>::max_digits10) << options.density << ",\n"
+        << "  \"rng\": \"xoshiro256** seeded by splitmix64\",\n"
+        << "  \"threads\": " << options.threads << ",\n"
+        << "  \"load\": " << jsonString(options.loadPath) << ",\n"
+        << "  \"agar\": " << jsonString(options.agarPath) << ",\n"
+        << "  \"build\": {\n"
+        << "    \"compiler\": " << jsonString(__VERSION__) << ",\n"
+        << "    \"flags\": [";
+    const char* flags[] = {
+#ifdef __OPTIMIZE__
+        "optimize",
+#endif
+#ifdef NDEBUG
+        "NDEBUG",
+#endif
+#ifdef __FAST_MATH__
+        "fast-math",
+#endif
+#ifdef __AVX2__
+        "avx2",
+#endif
+#ifdef __AVX512F__
+        "avx512f",
+#endif
+#ifdef __ARM_NEON
+        "neon",
+#endif
+#ifdef CONWAY_VULKAN
+        "CONWAY_VULKAN",
+#endif
+        nullptr
+    };
+    for (int i = 0; flags[i]; i++) out << (i ? ", " : "") << jsonString(flags[i]);
+    out << "]\n  }\n}\n";
+    if (!out) std::cerr << "Could not write " << path << "\n";
+    return bool(out);
+}
+
+Engine* createEngine(const std::string& name, const Options& options) {
+    if (name == "bitwise") {
+        return new BitwiseEngine(WIDTH, HEIGHT, options.rule, options.boundary, options.wordBits);
+    }
+    if (name == "lut") {
+        if (!LutEngine::supports(WIDTH, HEIGHT, options.boundary)) { std::cerr << "LUT engine needs even torus dimensions\n"; return nullptr; }
+        return new LutEngine(WIDTH, HEIGHT, options.rule, options.boundary);
+    }
+    if (name == "tiled") {
+        return new TiledEngine(WIDTH, HEIGHT, options.rule, options.boundary);
+    }
+    if (name == "vulkan") {
+#ifdef CONWAY_VULKAN
+        VulkanEngine* engine = new VulkanEngine(WIDTH, HEIGHT, options.rule, options.boundary);
+        if (!engine->ok()) { delete engine; return nullptr; }
+        return engine;
+#else
+        std::cerr << "Built without Vulkan; compile with -DCONWAY_VULKAN\n";
+        return nullptr;
+#endif
+    }
+    if (name == "hashlife") {
+        if (!HashLifeEngine::supports(options.rule)) { std::cerr << "HashLife cannot run B0 rules\n"; return nullptr; }
+        HashLifeEngine* engine = new HashLifeEngine(WIDTH, HEIGHT, options.rule, options.hashlifeMemoryMb, options.threads);
+        engine->setStepExponent(options.stepExponent);
+        return engine;
+    }
+    return nullptr;
+}
+
+// Runs every CPU engine on the same soup and reports time per generation.
+// The 64 KiB block table of the LUT engine competes with the grid for L1,
+// so which engine wins depends on the cache sizes of the machine.
+int runBenchmark(const Options& options) {
+    const char* names[] = { "bitwise", "lut", "tiled",
+#ifdef CONWAY_VULKAN
+                            "vulkan",
+#endif
+    };
+    std::vector<GLubyte> soup(WIDTH * HEIGHT), reference, result(WIDTH * HEIGHT);
+    randomSoup(soup.data(), soup.size(), options.density, options.seed);
+    for (const char* name : names) {
+        Engine* engine = createEngine(name, options);
+        if (!engine) continue;
+        engine->load(soup.data());
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < options.benchGenerations; i++) {
+            engine->step();
+        }
+        engine->finish();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        engine->store(result.data());
+        if (reference.empty()) reference = result;
+        std::cout << engine->name() << ": " << ms / options.benchGenerations << " ms/gen"
+                  << (result == reference ? "" : " (MISMATCH)") << "\n";
+        delete engine;
+    }
+    if (HashLifeEngine::supports(options.rule)) {
+        // HashLife advances the soup by the same number of generations in one
+        // jump, once per thread count, from a cold memo table each time. Its
+        // universe is unbounded, so runs are only checked against each other.
+        reference.clear();
+        for (int threads = 1; threads <= options.threads; threads *= 2) {
+            HashLifeEngine engine(WIDTH, HEIGHT, options.rule, options.hashlifeMemoryMb, threads);
+            engine.load(soup.data());
+            auto start = std::chrono::steady_clock::now();
+            engine.advanceUniverse(options.benchGenerations);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            engine.store(result.data());
+            if (reference.empty()) reference = result;
+            std::cout << "hashlife x" << threads << ": " << ms << " ms for " << options.benchGenerations << " gens"
+                      << (result == reference ? "" : " (MISMATCH)") << "\n";
+        }
+    }
+    return 0;
+}
+
+// One generation the slow, obvious way, for runCheck to hold the engines to.
+void referenceStep(const GLubyte* cells, GLubyte* next, Rule rule, Boundary boundary) {
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            int n = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    if (!dx && !dy) continue;
+                    int nx = x + dx, ny = y + dy;
+                    if (boundary == Boundary::Torus) {
+                        nx = (nx + WIDTH) % WIDTH;
+                        ny = (ny + HEIGHT) % HEIGHT;
+                    } else if (nx < 0 || nx >= WIDTH || ny < 0 || ny >= HEIGHT) {
+                        continue;
+                    }
+                    n += cells[ny * WIDTH + nx] != 0;
+                }
+            }
+            bool alive = cells[y * WIDTH + x] != 0;
+            next[y * WIDTH + x] = (((alive ? rule.survive : rule.birth) >> n) & 1) ? 255 : 0;
+        }
+    }
+}
+
+// Runs the soup through the engines and compares them, printing one line per
+// check; the exit status is nonzero if any failed. Every grid engine must
+// match referenceStep cell for cell. The Vulkan engine is skipped, not
+// failed, when the machine has no device it can run on. HashLife is run once
+// with a 1 MB budget, which forces table growth during load and collections
+// and split jumps during the step, and must still hash-cons every node once
+// and agree with a run that had room to spare.
+int runCheck(const Options& options) {
+    std::vector<GLubyte> soup(WIDTH * HEIGHT), result(WIDTH * HEIGHT), reference(WIDTH * HEIGHT);
+    randomSoup(soup.data(), soup.size(), options.density, options.seed);
+    int failures = 0;
+    std::vector<GLubyte> scratch(WIDTH * HEIGHT);
+    reference = soup;
+    for (int i = 0; i < options.checkGenerations; i++) {
+        referenceStep(reference.data(), scratch.data(), options.rule, options.boundary);
+        reference.swap(scratch);
+    }
+    std::vector<Engine*> engines = { createEngine("bitwise", options), createEngine("tiled", options) };
+    if (LutEngine::supports(WIDTH, HEIGHT, options.boundary)) engines.push_back(createEngine("lut", options));
+#ifdef CONWAY_VULKAN
+    VulkanEngine* vulkan = new VulkanEngine(WIDTH, HEIGHT, options.rule, options.boundary);
+    if (vulkan->ok()) {
+        engines.push_back(vulkan);
+    } else {
+        std::cout << "vulkan: " << (vulkan->hasDevice() ? "FAILED (setup)" : "skipped (no Vulkan device)") << "\n";
+        failures += vulkan->hasDevice();
+        delete vulkan;
+    }
+#endif
+    for (Engine* engine : engines) {
+        engine->load(soup.data());
+        for (int i = 0; i < options.checkGenerations; i++) {
+            engine->step();
+        }
+        engine->finish();
+        engine->store(result.data());
+        bool ok = result == reference;
+        std::cout << engine->name() << ": " << (ok ? "ok" : "FAILED (MISMATCH)") << "\n";
+        failures += !ok;
+        delete engine;
+    }
+    if (HashLifeEngine::supports(options.rule)) {
+        HashLifeEngine tight(WIDTH, HEIGHT, options.rule, 1, options.threads);
+        HashLifeEngine roomy(WIDTH, HEIGHT, options.rule, options.hashlifeMemoryMb, options.threads);
+        tight.load(soup.data());
+        size_t duplicates = tight.duplicateNodes();
+        tight.advanceUniverse(options.checkGenerations);
+        duplicates += tight.duplicateNodes();
+        roomy.load(soup.data());
+        roomy.advanceUniverse(options.checkGenerations);
+        tight.store(result.data());
+        roomy.store(reference.data());
+        bool ok = duplicates == 0 && result == reference;
+        std::cout << "hashlife at 1 MB: " << (ok ? "ok" : "FAILED");
+        if (duplicates) std::cout << " (" << duplicates << " duplicate nodes)";
+        if (result != reference) std::cout << " (MISMATCH)";
+        std::cout << "\n";
+        failures += !ok;
+    }
+    return failures ? 1 : 0;
+}
+
+// Prints a rectangle of the soup at a future generation using HashLife's
+// region query, without stepping or rendering the rest of the universe.
+int runQuery(const Options& options) {
+    HashLifeEngine engine(WIDTH, HEIGHT, options.rule, options.hashlifeMemoryMb, options.threads);
+    std::vector<GLubyte> soup(WIDTH * HEIGHT);
+    randomSoup(soup.data(), soup.size(), options.density, options.seed);
+    engine.load(soup.data());
+    std::vector<GLubyte> region(size_t(options.queryWidth) * options.queryHeight);
+    if (!engine.queryRegion(options.queryX, options.queryY, options.queryWidth, options.queryHeight, options.queryGenerations, region.data())) {
+        std::cerr << "Queries reach at most " << HashLifeEngine::maxQueryGenerations() << " generations ahead\n";
+        return 1;
+    }
+    for (int y = 0; y < options.queryHeight; y++) {
+        for (int x = 0; x < options.queryWidth; x++) {
+            std::cout << (region[y * options.queryWidth + x] ? 'O' : '.');
+        }
+        std::cout << "\n";
+    }
+    return 0;
+}
+
+// Runs a seed range of random soups headless and appends one record per
+// seed to the sweep file; seeds already in the file are skipped.
+int runSweep(const Options& options) {
+    SweepParams params = { uint32_t(options.sweepWidth), uint32_t(options.sweepHeight), options.rule, options.boundary,
+                           options.density, options.sweepGenerations };
+    SoupSweep sweep(params, options.threads);
+    writeManifest(options, options.sweepPath + ".manifest.json");
+    auto start = std::chrono::steady_clock::now();
+    if (!sweep.run(options.sweepPath, options.sweepFirst, options.sweepLast)) return 1;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Sweep took " << seconds << " s\n";
+    return 0;
+}
+
+int runSweepReport(const Options& options) {
+    SweepParams params;
+    std::vector<SweepRecord> records;
+    long validBytes;
+    if (!readSweepFile(options.sweepReport, params, records, validBytes)) { std::cerr << "Could not read " << options.sweepReport << "\n"; return 1; }
+    writeSweepReport(params, records, std::cout);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) return 1;
+    if (!options.manifestPath.empty() && !writeManifest(options, options.manifestPath)) return 1;
+
+    if (options.sweep) return runSweep(options);
+    if (!options.sweepReport.empty()) return runSweepReport(options);
+
+    if (options.benchGenerations > 0) return runBenchmark(options);
+    if (options.checkGenerations > 0) return runCheck(options);
+    if (options.query) {
+        if (!HashLifeEngine::supports(options.rule)) { std::cerr << "HashLife cannot run B0 rules\n"; return 1; }
+        return runQuery(options);
+    }
+
+    Engine* engine = createEngine(options.engine, options);
+    if (!engine && options.engine != "gpu") { std::cerr << "Unknown engine: " << options.engine << "\n"; return 1; }
+    HashLifeEngine* hashlife = dynamic_cast<HashLifeEngine*>(engine);
+    if ((!options.loadPath.empty() || !options.savePath.empty()) && !hashlife) { std::cerr << "--load and --save need --engine=hashlife\n"; return 1; }
+    if (!options.loadPath.empty()) {
+        std::ifstream in(options.loadPath);
+        if (!in || !hashlife->readMacrocell(in)) { std::cerr << "Could not load " << options.loadPath << "\n"; delete engine; return 1; }
+    }
+    if (!options.agarPath.empty()) {
+        TiledEngine* tiled = dynamic_cast<TiledEngine*>(engine);
+        if (!tiled) { std::cerr << "--agar needs --engine=tiled\n"; delete engine; return 1; }
+        std::ifstream in(options.agarPath);
+        std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        RlePattern agar;
+        if (!in || !parseRle(text, agar)) { std::cerr << "Could not read " << options.agarPath << "\n"; delete engine; return 1; }
+        if (!tiled->setAgar(agar.cells.data(), agar.width, agar.height)) { delete engine; return 1; }
+        std::cout << "Agar: " << agar.width << "x" << agar.height << ", period " << tiled->agarPeriod() << "\n";
+    }
+    std::cout << "Engine: " << (engine ? engine->name() : "gpu") << " " << ruleString(options.rule) << " " << boundaryName(options.boundary)
+              << ", seed " << options.seed << "\n";
+
+    GridVisualizer viz(options, engine);
     viz.initializeGrid();
+    if (options.benchDispatches > 0) {
+        if (engine) std::cerr << "--bench-dispatch measures the GPU engine\n";
+        else viz.benchmarkDispatches(options.benchDispatches);
+        viz.cleanup();
+        delete engine;
+        return 0;
+    }
+
+    ControlServer* control = nullptr;
+    if (!options.controlPath.empty()) {
+        control = new ControlServer(options.controlPath);
+        if (!control->ok()) { delete control; control = nullptr; }
+    }
 
+    std::cout << "Pacing: " << pacingName(options.pacing) << ", simulation "
+              << (options.simRate > 0 ? std::to_string(options.simRate) + " generations/s" : std::string("unthrottled"))
+              << (viz.threaded() ? " on its own thread" : "") << "\n";
+    // With a simulation thread the main loop only presents.
+    FramePacer pacer(options.pacing, options.simRate, viz.refreshRate());
+    viz.startSimulation(control, options.simRate);
     while (viz.isWindowOpen()) {
-        viz.computeStep();
-        viz.renderFrame();
+        viz.runMainTasks();
+        bool stepping = !viz.threaded() && !viz.isPaused();
+        if (!viz.threaded()) {
+            if (control) viz.applyCommands(*control);
+            viz.applyEdits();
+        }
+        if (stepping && pacer.stepDue(glfwGetTime())) {
+            viz.computeStep();
+            pacer.stepped(glfwGetTime());
+        }
+        if (pacer.frameDue(glfwGetTime())) {
+            viz.renderFrame();
+            pacer.presented(glfwGetTime());
+        }
+        viz.waitEvents(pacer.idleTime(glfwGetTime(), stepping));
     }
+    viz.stopSimulation();
+    delete control;
 
+    if (!options.savePath.empty()) {
+        std::ofstream out(options.savePath);
+        hashlife->writeMacrocell(out);
+        if (!out) std::cerr << "Could not save " << options.savePath << "\n";
+        writeManifest(options, options.savePath + ".manifest.json");
+    }
+    if (!options.trackPath.empty()) {
+        std::ofstream out(options.trackPath);
+        viz.writeCatalogue(out);
+        if (!out) std::cerr << "Could not write " << options.trackPath << "\n";
+        writeManifest(options, options.trackPath + ".manifest.json");
+    }
     viz.cleanup();
+    delete engine;
     return 0;
 }
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+// CPU-side simulation engine. Cells cross the interface as row-major bytes,
+// the same layout the R8 grid textures use: load() treats nonzero as alive,
+// store() writes 0 or 255.
+class Engine {
+public:
+    virtual ~Engine() {}
+    virtual const char* name() const = 0;
+    virtual void load(const uint8_t* cells) = 0;
+    virtual void store(uint8_t* cells) const = 0;
+    virtual void step() = 0;
+    // Waits for steps an engine queued on a device; store() implies it.
+    virtual void finish() {}
+};
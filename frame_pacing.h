@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+enum class PacingMode { Unlimited, Vsync, Adaptive, Fixed };
+
+struct Pacing {
+    PacingMode mode;
+    double fps;  // Fixed only
+};
+
+// Accepts "unlimited", "vsync", "adaptive" or a target frame rate such as "30".
+inline bool parsePacing(const std::string& text, Pacing& pacing) {
+    if (text == "unlimited") { pacing = { PacingMode::Unlimited, 0 }; return true; }
+    if (text == "vsync") { pacing = { PacingMode::Vsync, 0 }; return true; }
+    if (text == "adaptive") { pacing = { PacingMode::Adaptive, 0 }; return true; }
+    char* end;
+    double fps = strtod(text.c_str(), &end);
+    if (text.empty() || *end || !(fps > 0)) return false;
+    pacing = { PacingMode::Fixed, fps };
+    return true;
+}
+
+inline std::string pacingName(const Pacing& pacing) {
+    switch (pacing.mode) {
+    case PacingMode::Unlimited: return "unlimited";
+    case PacingMode::Vsync: return "vsync";
+    case PacingMode::Adaptive: return "adaptive";
+    default: return std::to_string(pacing.fps) + " fps";
+    }
+}
+
+// Swap interval for glfwSwapInterval; -1 lets a late frame tear instead of
+// waiting a whole refresh, where the driver supports it.
+inline int swapInterval(const Pacing& pacing) {
+    if (pacing.mode == PacingMode::Vsync) return 1;
+    if (pacing.mode == PacingMode::Adaptive) return -1;
+    return 0;
+}
+
+// Keeps two independent schedules on one clock in seconds: generations at
+// simRate per second (0 = as fast as the loop goes) and frames at the pacing
+// mode's rate. The loop steps and presents whichever is due, so a frame
+// always shows the latest finished generation and never holds the
+// simulation back to the display rate or the other way round.
+class FramePacer {
+private:
+    double stepInterval, frameInterval;
+    double nextStep, nextFrame;
+
+    // How far a schedule may fall behind before it stops catching up, so a
+    // stall is not followed by a burst of back-to-back steps or frames.
+    static constexpr double MAX_LAG = 0.25;
+
+    static void advance(double& next, double interval, double now) {
+        next += interval;
+        if (next < now - MAX_LAG) next = now;
+    }
+
+public:
+    FramePacer(const Pacing& pacing, double simRate, double refreshRate)
+        : stepInterval(simRate > 0 ? 1.0 / simRate : 0), frameInterval(0), nextStep(0), nextFrame(0) {
+        if (pacing.mode == PacingMode::Fixed) frameInterval = 1.0 / pacing.fps;
+        // Presenting once per refresh keeps the swap from blocking the loop
+        // for most of a frame; the swap itself still lines up with vblank.
+        else if (pacing.mode != PacingMode::Unlimited && refreshRate > 0) frameInterval = 1.0 / refreshRate;
+    }
+
+    bool stepDue(double now) const { return now >= nextStep; }
+    bool frameDue(double now) const { return now >= nextFrame; }
+
+    void stepped(double now) { advance(nextStep, stepInterval, now); }
+    void presented(double now) { advance(nextFrame, frameInterval, now); }
+
+    double untilStep(double now) const { return std::max(0.0, nextStep - now); }
+
+    // Time the loop can sleep before anything is due; steps only count when running.
+    double idleTime(double now, bool running) const {
+        double next = running ? std::min(nextStep, nextFrame) : nextFrame;
+        return std::max(0.0, next - now);
+    }
+};
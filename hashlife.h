@@ -0,0 +1,743 @@
+#pragma once
+
+#include "engine.h"
+#include "lut_engine.h"
+#include "rule.h"
+#include "task_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Nodes live in slab arenas and refer to each other by 32-bit index. Level 0
+// nodes are single cells (index 0 dead, 1 alive); a level k node covers
+// 2^k x 2^k cells and memoizes the state of its central 2^(k-1) square
+// 2^(k-2) generations ahead in `result`.
+typedef uint32_t NodeId;
+
+#define NO_NODE 0xFFFFFFFFu
+#define HASHLIFE_MAX_LEVEL 62
+#define HASHLIFE_SLAB_BITS 16
+#define HASHLIFE_SLAB_NODES (1u << HASHLIFE_SLAB_BITS)
+#define HASHLIFE_MAX_SLABS (1u << (32 - HASHLIFE_SLAB_BITS))
+#define HASHLIFE_STEP_CACHE (1u << 18)
+#define HASHLIFE_DEFAULT_MEMORY_MB 1024
+// Nodes at or above this level fan their nine sub-results and four combines
+// out as tasks; below it the recursion is too cheap to be worth a task.
+#define HASHLIFE_PARALLEL_LEVEL 9
+
+struct HashNode {
+    NodeId nw, ne, sw, se;
+    NodeId result;
+    uint8_t level;
+    uint8_t marked;
+};
+
+// Results of advance() for step sizes other than the full 2^(k-2). Direct
+// mapped and lossy: a colliding entry simply overwrites the old one. The two
+// words are written independently, so `check` holds generations ^ key and a
+// torn entry fails the comparison instead of returning a wrong node.
+struct StepCacheEntry {
+    std::atomic<uint64_t> key;  // node << 32 | result
+    std::atomic<uint64_t> check;
+};
+
+// HashLife on an unbounded plane. The engine interface exposes the window
+// [0, width) x [0, height) of that plane; queryRegion() reads any rectangle at
+// any future generation while only evaluating the nodes in its light cone.
+//
+// Once the node store outgrows its memory budget it is mark-compacted: live
+// nodes slide down to the lowest indices and the open-addressed hash table is
+// rebuilt. Slabs and tables are kept, so steady-state stepping never allocates.
+// A jump that fills the table part way is abandoned, the store collected and
+// the jump redone in halves; only a single generation that still does not
+// fit grows the table.
+//
+// With more than one thread, the top levels of result() and advance() run
+// their sub-results as pool tasks. Nodes are claimed with an atomic bump of
+// nodeCount and published by a CAS into the hash table; a thread that loses
+// the race for a slot to an identical node adopts the winner and leaves its
+// own copy for the collector. Memoized results are idempotent, so concurrent
+// writers store the same value. Collection only happens between steps.
+class HashLifeEngine : public Engine {
+private:
+    int width, height;
+    Rule rule;
+    uint8_t blockTable[65536];
+    HashNode* slabs[HASHLIFE_MAX_SLABS];
+    std::mutex slabMutex;
+    std::atomic<NodeId> nodeCount;
+    std::atomic<NodeId>* table;  // open addressing, linear probing, 0 = free (leaves are never hashed)
+    size_t tableSize;
+    bool stepping;  // inside advance(): the table cannot grow
+    std::atomic<bool> exhausted;  // the table filled up during advance()
+    StepCacheEntry* stepCache;
+    std::vector<NodeId> forwarding;
+    TaskPool* pool;
+    NodeId emptyNodes[HASHLIFE_MAX_LEVEL + 1];
+    NodeId root;
+    uint64_t generation;
+    int stepExponent;  // step() advances 2^stepExponent generations
+    size_t memoryLimit;
+
+    HashNode& node(NodeId id) { return slabs[id >> HASHLIFE_SLAB_BITS][id & (HASHLIFE_SLAB_NODES - 1)]; }
+    NodeId loadResult(NodeId id) const { return __atomic_load_n(&node(id).result, __ATOMIC_ACQUIRE); }
+    void storeResult(NodeId id, NodeId value) { __atomic_store_n(&node(id).result, value, __ATOMIC_RELEASE); }
+    const HashNode& node(NodeId id) const { return slabs[id >> HASHLIFE_SLAB_BITS][id & (HASHLIFE_SLAB_NODES - 1)]; }
+    int level(NodeId id) const { return node(id).level; }
+    bool isEmpty(NodeId id) const { return id == emptyNodes[level(id)]; }
+
+    static size_t hashChildren(NodeId nw, NodeId ne, NodeId sw, NodeId se) {
+        uint64_t h = nw;
+        h = h * 0x9E3779B97F4A7C15ull ^ ne;
+        h = h * 0x9E3779B97F4A7C15ull ^ sw;
+        h = h * 0x9E3779B97F4A7C15ull ^ se;
+        return size_t(h ^ (h >> 32));
+    }
+
+    size_t nodeCapacity() const { return tableSize / 4 * 3; }
+
+    // Returns NO_NODE once the table is three quarters full while stepping;
+    // threads racing past the check overshoot by at most one node each, which
+    // the last quarter absorbs. Outside a step the table just grows.
+    NodeId allocate(const HashNode& value) {
+        if (nodeCount.load(std::memory_order_relaxed) >= nodeCapacity()) {
+            if (stepping) {
+                exhausted = true;
+                return NO_NODE;
+            }
+            growTable();
+        }
+        NodeId id = nodeCount.fetch_add(1, std::memory_order_relaxed);
+        size_t slab = id >> HASHLIFE_SLAB_BITS;
+        if (!__atomic_load_n(&slabs[slab], __ATOMIC_ACQUIRE)) {
+            std::lock_guard<std::mutex> lock(slabMutex);
+            if (!slabs[slab]) __atomic_store_n(&slabs[slab], new HashNode[HASHLIFE_SLAB_NODES], __ATOMIC_RELEASE);
+        }
+        node(id) = value;
+        return id;
+    }
+
+    void rebuildTable() {
+        memset(static_cast<void*>(table), 0, tableSize * sizeof(NodeId));
+        size_t mask = tableSize - 1;
+        NodeId count = nodeCount.load();
+        for (NodeId id = 2; id < count; id++) {
+            const HashNode& n = node(id);
+            size_t slot = hashChildren(n.nw, n.ne, n.sw, n.se) & mask;
+            while (table[slot].load(std::memory_order_relaxed)) slot = (slot + 1) & mask;
+            table[slot].store(id, std::memory_order_relaxed);
+        }
+    }
+
+    void growTable() {
+        if (tableSize >= (size_t(1) << 32)) {
+            std::cerr << "HashLife node store exhausted\n";
+            abort();
+        }
+        tableSize *= 2;
+        free(table);
+        table = static_cast<std::atomic<NodeId>*>(calloc(tableSize, sizeof(NodeId)));
+        rebuildTable();
+    }
+
+    // When the store is exhausted mid-step this hands back a stand-in node of
+    // the right level; whatever is built from it is discarded by the caller.
+    NodeId join(NodeId nw, NodeId ne, NodeId sw, NodeId se) {
+        size_t mask = tableSize - 1;
+        size_t slot = hashChildren(nw, ne, sw, se) & mask;
+        NodeId created = NO_NODE;
+        while (true) {
+            NodeId id = table[slot].load(std::memory_order_acquire);
+            if (!id) {
+                if (created == NO_NODE) {
+                    created = allocate({ nw, ne, sw, se, NO_NODE, uint8_t(level(nw) + 1), 0 });
+                    if (created == NO_NODE) return emptyNodes[level(nw) + 1];
+                    // allocate() may have grown the table, which was rebuilt
+                    // without the new node: probe again in the new one.
+                    if (mask != tableSize - 1) {
+                        mask = tableSize - 1;
+                        slot = hashChildren(nw, ne, sw, se) & mask;
+                        continue;
+                    }
+                }
+                if (table[slot].compare_exchange_strong(id, created, std::memory_order_acq_rel)) return created;
+                // Lost the slot; `id` now holds the winner, which may be our node.
+            }
+            const HashNode& n = node(id);
+            if (n.nw == nw && n.ne == ne && n.sw == sw && n.se == se) return id;
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    NodeId centre(NodeId id) {
+        const HashNode& n = node(id);
+        return join(node(n.nw).se, node(n.ne).sw, node(n.sw).ne, node(n.se).nw);
+    }
+
+    // Level 1 node <-> 2x2 block nibble as used by buildBlockTable().
+    int nibble(NodeId id) const {
+        const HashNode& n = node(id);
+        return int(n.nw) | (int(n.ne) << 1) | (int(n.sw) << 2) | (int(n.se) << 3);
+    }
+
+    NodeId fromNibble(int bits) { return join(bits & 1, (bits >> 1) & 1, (bits >> 2) & 1, (bits >> 3) & 1); }
+
+    // The nine overlapping level k-1 nodes of a level k node, row by row.
+    void subnodes(NodeId id, NodeId out[9]) {
+        const HashNode& n = node(id);
+        const HashNode &nw = node(n.nw), &ne = node(n.ne), &sw = node(n.sw), &se = node(n.se);
+        out[0] = n.nw;
+        out[1] = join(nw.ne, ne.nw, nw.se, ne.sw);
+        out[2] = n.ne;
+        out[3] = join(nw.sw, nw.se, sw.nw, sw.ne);
+        out[4] = join(nw.se, ne.sw, sw.ne, se.nw);
+        out[5] = join(ne.sw, ne.se, se.nw, se.ne);
+        out[6] = n.sw;
+        out[7] = join(sw.ne, se.nw, sw.se, se.sw);
+        out[8] = n.se;
+    }
+
+    // Runs f(i) for i < count, as pool tasks when the node is high enough
+    // in the tree for the work to outweigh the task overhead.
+    template <typename F>
+    void forEach(int k, int count, F f) {
+        if (pool && k >= HASHLIFE_PARALLEL_LEVEL) {
+            TaskGroup group(*pool);
+            for (int i = 0; i < count; i++) group.run([&f, i] { f(i); });
+            group.wait();
+        } else {
+            for (int i = 0; i < count; i++) f(i);
+        }
+    }
+
+    // Once the store is exhausted nothing more is memoized: a result may
+    // already rest on stand-in nodes, and the whole jump is redone anyway.
+    NodeId result(NodeId id) {
+        NodeId memo = loadResult(id);
+        if (memo != NO_NODE) return memo;
+        int k = level(id);
+        if (exhausted) return emptyNodes[k - 1];
+        NodeId out;
+        if (isEmpty(id)) {
+            out = emptyNodes[k - 1];
+        } else if (k == 2) {
+            const HashNode& n = node(id);
+            out = fromNibble(blockTable[blockIndex(nibble(n.nw), nibble(n.ne), nibble(n.sw), nibble(n.se))]);
+        } else {
+            NodeId sub[9], r[9], q[4];
+            subnodes(id, sub);
+            forEach(k, 9, [&](int i) { r[i] = result(sub[i]); });
+            forEach(k, 4, [&](int i) {
+                int c = (i >> 1) * 3 + (i & 1);
+                q[i] = result(join(r[c], r[c + 1], r[c + 3], r[c + 4]));
+            });
+            out = join(q[0], q[1], q[2], q[3]);
+        }
+        if (!exhausted) storeResult(id, out);
+        return out;
+    }
+
+    StepCacheEntry& cacheSlot(NodeId id, uint64_t generations) {
+        return stepCache[hashChildren(id, NodeId(generations), NodeId(generations >> 32), 0) & (HASHLIFE_STEP_CACHE - 1)];
+    }
+
+    bool cacheLookup(NodeId id, uint64_t generations, NodeId& out) {
+        StepCacheEntry& entry = cacheSlot(id, generations);
+        uint64_t key = entry.key.load(std::memory_order_relaxed);
+        uint64_t check = entry.check.load(std::memory_order_relaxed);
+        if (NodeId(key >> 32) != id || (check ^ key) != generations) return false;
+        out = NodeId(key);
+        return true;
+    }
+
+    void cacheStore(NodeId id, uint64_t generations, NodeId result) {
+        StepCacheEntry& entry = cacheSlot(id, generations);
+        uint64_t key = (uint64_t(id) << 32) | result;
+        entry.key.store(key, std::memory_order_relaxed);
+        entry.check.store(generations ^ key, std::memory_order_relaxed);
+    }
+
+    // Centre of a node advanced by any generations <= 2^(level-2). Runs the
+    // nine subnodes through the first part and the four quadrants through the rest.
+    NodeId advance(NodeId id, uint64_t generations) {
+        if (generations == 0) return centre(id);
+        int k = level(id);
+        uint64_t full = uint64_t(1) << (k - 2);
+        if (generations == full) return result(id);
+        if (isEmpty(id)) return emptyNodes[k - 1];
+        NodeId out;
+        if (cacheLookup(id, generations, out)) return out;
+        if (exhausted) return emptyNodes[k - 1];
+
+        uint64_t half = full / 2;
+        uint64_t first = generations > half ? generations - half : 0;
+        uint64_t second = generations - first;
+        NodeId sub[9], r[9], q[4];
+        subnodes(id, sub);
+        forEach(k, 9, [&](int i) { r[i] = advance(sub[i], first); });
+        forEach(k, 4, [&](int i) {
+            int c = (i >> 1) * 3 + (i & 1);
+            q[i] = advance(join(r[c], r[c + 1], r[c + 3], r[c + 4]), second);
+        });
+        out = join(q[0], q[1], q[2], q[3]);
+        if (!exhausted) cacheStore(id, generations, out);
+        return out;
+    }
+
+    // advance() with the table closed to growth; check exhausted afterwards.
+    NodeId guardedAdvance(NodeId id, uint64_t generations) {
+        stepping = true;
+        NodeId out = advance(id, generations);
+        stepping = false;
+        return out;
+    }
+
+    // Wraps a node in one a level up with it in the middle.
+    NodeId expand(NodeId id) {
+        const HashNode& n = node(id);
+        NodeId e = emptyNodes[n.level - 1];
+        return join(join(e, e, e, n.nw), join(e, e, n.ne, e), join(e, n.sw, e, e), join(n.se, e, e, e));
+    }
+
+    bool fitsCentre(NodeId id) const {
+        const HashNode& n = node(id);
+        NodeId e = emptyNodes[n.level - 2];
+        const HashNode &nw = node(n.nw), &ne = node(n.ne), &sw = node(n.sw), &se = node(n.se);
+        return nw.nw == e && nw.ne == e && nw.sw == e && ne.nw == e && ne.ne == e && ne.se == e &&
+               sw.nw == e && sw.sw == e && sw.se == e && se.ne == e && se.sw == e && se.se == e;
+    }
+
+    int64_t half(NodeId id) const { return int64_t(1) << (level(id) - 1); }
+
+    // Aligned node of the given level whose top-left corner is (x, y) in
+    // universe coordinates; the root is centred on the origin.
+    NodeId alignedNode(int64_t x, int64_t y, int targetLevel) const {
+        int64_t h = half(root);
+        if (x < -h || y < -h || x >= h || y >= h) return emptyNodes[targetLevel];
+        NodeId id = root;
+        int64_t ox = -h, oy = -h;
+        while (level(id) > targetLevel) {
+            int64_t q = half(id);
+            bool east = x >= ox + q, south = y >= oy + q;
+            const HashNode& n = node(id);
+            id = south ? (east ? n.se : n.sw) : (east ? n.ne : n.nw);
+            ox += east ? q : 0;
+            oy += south ? q : 0;
+        }
+        return id;
+    }
+
+    NodeId build(const uint8_t* cells, int64_t x, int64_t y, int k) {
+        if (x >= width || y >= height) return emptyNodes[k];
+        if (k == 0) return cells[y * width + x] ? 1 : 0;
+        int64_t q = int64_t(1) << (k - 1);
+        return join(build(cells, x, y, k - 1), build(cells, x + q, y, k - 1),
+                    build(cells, x, y + q, k - 1), build(cells, x + q, y + q, k - 1));
+    }
+
+    // Node for the k-level square at (x, y) of an 8x8 macrocell leaf, one bit per cell.
+    NodeId leafNode(const uint8_t rows[8], int x, int y, int k) {
+        if (k == 0) return (rows[y] >> x) & 1;
+        int q = 1 << (k - 1);
+        return join(leafNode(rows, x, y, k - 1), leafNode(rows, x + q, y, k - 1),
+                    leafNode(rows, x, y + q, k - 1), leafNode(rows, x + q, y + q, k - 1));
+    }
+
+    // Appends the definition of a node and everything below it, each shared
+    // subtree once. Returns its 1-based line number, 0 for an empty node.
+    size_t writeNode(NodeId id, std::unordered_map<NodeId, size_t>& lines, std::string& out) const {
+        if (isEmpty(id)) return 0;
+        auto found = lines.find(id);
+        if (found != lines.end()) return found->second;
+        const HashNode& n = node(id);
+        if (n.level == 3) {
+            uint8_t cells[64] = {};
+            readCells(id, 0, 0, 0, 0, 8, 8, cells);
+            for (int y = 0; y < 8; y++) {
+                int end = 8;
+                while (end > 0 && !cells[y * 8 + end - 1]) end--;
+                for (int x = 0; x < end; x++) out += cells[y * 8 + x] ? '*' : '.';
+                out += '$';
+            }
+        } else {
+            size_t nw = writeNode(n.nw, lines, out), ne = writeNode(n.ne, lines, out);
+            size_t sw = writeNode(n.sw, lines, out), se = writeNode(n.se, lines, out);
+            out += std::to_string(n.level) + " " + std::to_string(nw) + " " + std::to_string(ne) + " "
+                 + std::to_string(sw) + " " + std::to_string(se);
+        }
+        out += '\n';
+        size_t line = lines.size() + 1;
+        lines[id] = line;
+        return line;
+    }
+
+    // Writes the live cells of a node (top-left at ox, oy) that fall inside
+    // the rectangle into out, which is row-major with stride w.
+    void readCells(NodeId id, int64_t ox, int64_t oy, int64_t x, int64_t y, int w, int h, uint8_t* out) const {
+        int64_t size = int64_t(1) << level(id);
+        if (isEmpty(id) || ox >= x + w || oy >= y + h || ox + size <= x || oy + size <= y) return;
+        if (level(id) == 0) {
+            out[(oy - y) * w + (ox - x)] = 255;
+            return;
+        }
+        const HashNode& n = node(id);
+        int64_t q = size / 2;
+        readCells(n.nw, ox, oy, x, y, w, h, out);
+        readCells(n.ne, ox + q, oy, x, y, w, h, out);
+        readCells(n.sw, ox, oy + q, x, y, w, h, out);
+        readCells(n.se, ox + q, oy + q, x, y, w, h, out);
+    }
+
+    // The node with the rectangle's cells (row-major, stride w) written over
+    // it; subtrees that miss the rectangle are shared with the old one.
+    NodeId patch(NodeId id, int64_t ox, int64_t oy, int64_t x, int64_t y, int w, int h, const uint8_t* cells) {
+        int64_t size = int64_t(1) << level(id);
+        if (ox >= x + w || oy >= y + h || ox + size <= x || oy + size <= y) return id;
+        if (level(id) == 0) return cells[(oy - y) * w + (ox - x)] ? 1 : 0;
+        HashNode n = node(id);
+        int64_t q = size / 2;
+        return join(patch(n.nw, ox, oy, x, y, w, h, cells), patch(n.ne, ox + q, oy, x, y, w, h, cells),
+                    patch(n.sw, ox, oy + q, x, y, w, h, cells), patch(n.se, ox + q, oy + q, x, y, w, h, cells));
+    }
+
+    uint64_t countCells(NodeId id, std::unordered_map<NodeId, uint64_t>& memo) const {
+        if (id <= 1) return id;
+        if (isEmpty(id)) return 0;
+        auto found = memo.find(id);
+        if (found != memo.end()) return found->second;
+        const HashNode& n = node(id);
+        uint64_t count = countCells(n.nw, memo) + countCells(n.ne, memo) + countCells(n.sw, memo) + countCells(n.se, memo);
+        memo[id] = count;
+        return count;
+    }
+
+    void mark(NodeId id, bool keepResults) {
+        HashNode& n = node(id);
+        if (n.marked) return;
+        n.marked = 1;
+        if (n.level > 0) {
+            mark(n.nw, keepResults);
+            mark(n.ne, keepResults);
+            mark(n.sw, keepResults);
+            mark(n.se, keepResults);
+        }
+        if (keepResults && n.result != NO_NODE) mark(n.result, keepResults);
+    }
+
+    size_t memoryUsed() const {
+        return size_t(nodeCount.load()) * sizeof(HashNode) + tableSize * sizeof(NodeId) + HASHLIFE_STEP_CACHE * sizeof(StepCacheEntry);
+    }
+
+    // Mark-compact: live nodes slide down in index order, so every move lands
+    // on a slot that has already been read, and all references are rewritten
+    // through the forwarding table.
+    void collect(bool keepResults) {
+        for (NodeId id = 0; id < 2; id++) node(id).marked = 1;
+        for (int k = 0; k <= HASHLIFE_MAX_LEVEL; k++) mark(emptyNodes[k], keepResults);
+        mark(root, keepResults);
+        // Step-cache entries are results too: keep both ends alive, or the
+        // entry is dropped below.
+        if (keepResults) {
+            for (size_t i = 0; i < HASHLIFE_STEP_CACHE; i++) {
+                uint64_t key = stepCache[i].key.load();
+                if (NodeId(key >> 32) == NO_NODE) continue;
+                mark(NodeId(key >> 32), true);
+                mark(NodeId(key), true);
+            }
+        }
+
+        NodeId count = nodeCount.load();
+        if (forwarding.size() < count) forwarding.resize(count);
+        NodeId top = 0;
+        for (NodeId id = 0; id < count; id++) forwarding[id] = node(id).marked ? top++ : NO_NODE;
+        for (NodeId id = 0; id < count; id++) {
+            HashNode n = node(id);
+            if (!n.marked) continue;
+            n.marked = 0;
+            if (n.level > 0) {
+                n.nw = forwarding[n.nw];
+                n.ne = forwarding[n.ne];
+                n.sw = forwarding[n.sw];
+                n.se = forwarding[n.se];
+            }
+            if (n.result != NO_NODE) n.result = forwarding[n.result];
+            node(forwarding[id]) = n;
+        }
+        for (size_t i = 0; i < HASHLIFE_STEP_CACHE; i++) {
+            uint64_t key = stepCache[i].key.load(), generations = stepCache[i].check.load() ^ key;
+            NodeId from = NodeId(key >> 32), to = NodeId(key);
+            if (from == NO_NODE) continue;
+            from = forwarding[from];
+            to = forwarding[to];
+            if (from == NO_NODE || to == NO_NODE) from = to = NO_NODE, generations = 0;
+            key = (uint64_t(from) << 32) | to;
+            stepCache[i].key.store(key);
+            stepCache[i].check.store(generations ^ key);
+        }
+        for (int k = 0; k <= HASHLIFE_MAX_LEVEL; k++) emptyNodes[k] = forwarding[emptyNodes[k]];
+        root = forwarding[root];
+        nodeCount = top;
+        rebuildTable();
+    }
+
+    void collectIfNeeded() {
+        if (memoryUsed() <= memoryLimit) return;
+        collect(true);
+        // Memoized results can hold most of the store; drop them if keeping
+        // them leaves no headroom.
+        if (memoryUsed() > memoryLimit / 4 * 3) collect(false);
+    }
+
+public:
+    // The hash table cannot grow while other threads probe it, so it is sized
+    // up front for one node per HashNode-sized slice of the budget.
+    HashLifeEngine(int width, int height, Rule rule, size_t memoryMegabytes = HASHLIFE_DEFAULT_MEMORY_MB, int threads = 1)
+        : width(width), height(height), rule(rule), slabs(), nodeCount(0), tableSize(1 << 16), stepping(false), exhausted(false),
+          pool(nullptr), generation(0),
+          stepExponent(0), memoryLimit(memoryMegabytes << 20) {
+        while (tableSize * sizeof(HashNode) < memoryLimit) tableSize *= 2;
+        table = static_cast<std::atomic<NodeId>*>(calloc(tableSize, sizeof(NodeId)));
+        stepCache = new StepCacheEntry[HASHLIFE_STEP_CACHE];
+        for (size_t i = 0; i < HASHLIFE_STEP_CACHE; i++) {
+            stepCache[i].key = ~uint64_t(0);
+            stepCache[i].check = ~uint64_t(0);
+        }
+        if (threads > 1) pool = new TaskPool(threads);
+        buildBlockTable(rule, blockTable);
+        for (int i = 0; i < 2; i++) allocate({ NO_NODE, NO_NODE, NO_NODE, NO_NODE, NO_NODE, 0, 0 });
+        emptyNodes[0] = 0;
+        for (int k = 1; k <= HASHLIFE_MAX_LEVEL; k++) {
+            NodeId e = emptyNodes[k - 1];
+            emptyNodes[k] = join(e, e, e, e);
+        }
+        root = emptyNodes[3];
+    }
+
+    ~HashLifeEngine() {
+        delete pool;
+        for (HashNode* slab : slabs) delete[] slab;
+        delete[] stepCache;
+        free(table);
+    }
+
+    static bool supports(Rule rule) { return !(rule.birth & 1); }
+
+    const char* name() const override { return "hashlife"; }
+
+    void load(const uint8_t* cells) override {
+        int k = 3;
+        while ((int64_t(1) << (k - 1)) < std::max(width, height)) k++;
+        // The window's top-left corner sits at the origin, i.e. in the middle of the root.
+        NodeId quadrant = build(cells, 0, 0, k - 1);
+        NodeId e = emptyNodes[k - 1];
+        root = join(e, e, e, quadrant);
+        generation = 0;
+        collectIfNeeded();
+    }
+
+    // Overwrites a w x h rectangle (row-major, nonzero = alive) with its
+    // top-left corner at (x, y), leaving the rest of the universe and the
+    // generation alone. Only the nodes on the way to the root are rebuilt.
+    // Fails if the rectangle lies beyond what the root can grow to cover.
+    bool setCells(int64_t x, int64_t y, int w, int h, const uint8_t* cells) {
+        while (x < -half(root) || y < -half(root) || x > half(root) - w || y > half(root) - h) {
+            if (level(root) >= HASHLIFE_MAX_LEVEL - 2) return false;
+            root = expand(root);
+        }
+        int64_t rh = half(root);
+        root = patch(root, -rh, -rh, x, y, w, h, cells);
+        collectIfNeeded();
+        return true;
+    }
+
+    void store(uint8_t* cells) const override {
+        memset(cells, 0, size_t(width) * height);
+        int64_t h = half(root);
+        readCells(root, -h, -h, 0, 0, width, height, cells);
+    }
+
+    void step() override { advanceUniverse(uint64_t(1) << stepExponent); }
+
+    // Changing the step size keeps the memo: result() always caches the full
+    // 2^(level-2) jump, so a step of 2^k reuses every level k+2 result from
+    // earlier runs, and the partial jumps above it sit in the step cache under
+    // their own generation count.
+    //
+    // A steadily growing pattern adds nodes in proportion to the generations
+    // a jump covers, so steps are capped at one generation per node the
+    // budget holds; larger ones would only be split again.
+    void setStepExponent(int exponent) { stepExponent = std::max(0, std::min(exponent, maxStepExponent())); }
+    int maxStepExponent() const {
+        int limit = 0;
+        while (limit < HASHLIFE_MAX_LEVEL - 4 && (size_t(2) << limit) <= nodeCapacity()) limit++;
+        return limit;
+    }
+    int currentStepExponent() const { return stepExponent; }
+
+    // Jumps are split at the largest step the root can grow to hold.
+    void advanceUniverse(uint64_t generations) {
+        uint64_t jump = std::min(generations, uint64_t(1) << (HASHLIFE_MAX_LEVEL - 4));
+        while (generations > 0) {
+            jump = std::min(jump, generations);
+            while (!fitsCentre(root) || (uint64_t(1) << (level(root) - 2)) < jump) root = expand(root);
+            NodeId top = expand(root);
+            NodeId next = guardedAdvance(top, jump);
+            if (exhausted) {
+                exhausted = false;
+                collect(false);
+                if (jump > 1) jump /= 2;
+                else growTable();
+                continue;
+            }
+            root = next;
+            generation += jump;
+            generations -= jump;
+            collectIfNeeded();
+        }
+    }
+
+    // State of [x, x + w) x [y, y + h) after `generations` more generations,
+    // without moving the universe forward. The rectangle is covered by the
+    // centres of half-aligned nodes of the smallest level whose full step
+    // reaches that far; each one only pulls in its own light cone. Fails for
+    // more than maxQueryGenerations(), whose nodes the root could not hold.
+    static uint64_t maxQueryGenerations() { return uint64_t(1) << (HASHLIFE_MAX_LEVEL - 3); }
+
+    bool queryRegion(int64_t x, int64_t y, int w, int h, uint64_t generations, uint8_t* out) {
+        if (generations > maxQueryGenerations()) return false;
+        memset(out, 0, size_t(w) * h);
+        collectIfNeeded();
+        if (generations == 0) {
+            int64_t rh = half(root);
+            readCells(root, -rh, -rh, x, y, w, h, out);
+            return true;
+        }
+        int k = 3;
+        while ((uint64_t(1) << (k - 2)) < generations) k++;
+        // Every aligned node the query needs must lie inside the root or
+        // entirely outside it.
+        while (level(root) <= k) root = expand(root);
+        int64_t side = int64_t(1) << (k - 1), quarter = side / 2;
+        auto floorDiv = [](int64_t a, int64_t b) { return a >= 0 ? a / b : -((-a + b - 1) / b); };
+        for (int64_t ty = floorDiv(y, side); ty * side < y + h; ty++) {
+            for (int64_t tx = floorDiv(x, side); tx * side < x + w; tx++) {
+                int64_t nx = tx * side - quarter, ny = ty * side - quarter;
+                NodeId a[16];
+                for (int i = 0; i < 16; i++) a[i] = alignedNode(nx + (i % 4) * quarter, ny + (i / 4) * quarter, k - 2);
+                NodeId n = join(join(a[0], a[1], a[4], a[5]), join(a[2], a[3], a[6], a[7]),
+                                   join(a[8], a[9], a[12], a[13]), join(a[10], a[11], a[14], a[15]));
+                // The jump cannot be split without moving the universe, so a
+                // query that does not fit grows the table instead; collecting
+                // would move n.
+                NodeId r = guardedAdvance(n, generations);
+                while (exhausted) {
+                    exhausted = false;
+                    growTable();
+                    r = guardedAdvance(n, generations);
+                }
+                readCells(r, tx * side, ty * side, x, y, w, h, out);
+            }
+        }
+        return true;
+    }
+
+    // Macrocell ([M2]) files are the node store written out: 8x8 leaves as
+    // rows of '.' and '*' ended by '$', then one "level nw ne sw se" line per
+    // larger node, children given by line number and 0 for empty. The last
+    // line is the root, centred on the origin just like ours, so patterns of
+    // any size load and save without ever being expanded into cells.
+    bool readMacrocell(std::istream& in) {
+        std::string line;
+        if (!std::getline(in, line) || line.compare(0, 4, "[M2]") != 0) { std::cerr << "Not a Macrocell file\n"; return false; }
+        std::vector<NodeId> defined;
+        std::vector<int> levels;
+        for (int number = 2; std::getline(in, line); number++) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            if (line[0] == '#') {
+                Rule fileRule;
+                if (line.compare(0, 3, "#R ") == 0 && parseRule(line.c_str() + 3, fileRule) && fileRule != rule) {
+                    std::cerr << "Pattern uses rule " << ruleString(fileRule) << ", engine runs " << ruleString(rule) << "\n";
+                    return false;
+                }
+                continue;
+            }
+            if (line[0] == '.' || line[0] == '*' || line[0] == '$') {
+                uint8_t rows[8] = {};
+                int x = 0, y = 0;
+                for (char c : line) {
+                    if (c == '$') { x = 0; y++; continue; }
+                    if (x >= 8 || y >= 8 || (c != '.' && c != '*')) { std::cerr << "Bad Macrocell leaf on line " << number << "\n"; return false; }
+                    if (c == '*') rows[y] |= 1 << x;
+                    x++;
+                }
+                defined.push_back(leafNode(rows, 0, 0, 3));
+                levels.push_back(3);
+                continue;
+            }
+            int k;
+            size_t child[4];
+            if (sscanf(line.c_str(), "%d %zu %zu %zu %zu", &k, &child[0], &child[1], &child[2], &child[3]) != 5 || k < 4 || k > HASHLIFE_MAX_LEVEL) {
+                std::cerr << "Bad Macrocell node on line " << number << "\n";
+                return false;
+            }
+            NodeId ids[4];
+            for (int i = 0; i < 4; i++) {
+                if (child[i] > defined.size() || (child[i] && levels[child[i] - 1] != k - 1)) { std::cerr << "Bad Macrocell reference on line " << number << "\n"; return false; }
+                ids[i] = child[i] ? defined[child[i] - 1] : emptyNodes[k - 1];
+            }
+            defined.push_back(join(ids[0], ids[1], ids[2], ids[3]));
+            levels.push_back(k);
+        }
+        if (defined.empty()) { std::cerr << "Empty Macrocell file\n"; return false; }
+        root = defined.back();
+        if (level(root) < 4) root = expand(root);
+        generation = 0;
+        collectIfNeeded();
+        return true;
+    }
+
+    void writeMacrocell(std::ostream& out) const {
+        std::unordered_map<NodeId, size_t> lines;
+        std::string body;
+        writeNode(root, lines, body);
+        if (lines.empty()) body = std::to_string(std::max(4, int(level(root)))) + " 0 0 0 0\n";
+        out << "[M2] (conway)\n#R " << ruleString(rule) << "\n" << body;
+    }
+
+    uint64_t currentGeneration() const { return generation; }
+    uint64_t population() const {
+        std::unordered_map<NodeId, uint64_t> memo;
+        return countCells(root, memo);
+    }
+    size_t nodes() const { return nodeCount.load(); }
+
+    // Nodes with the same children as an earlier one. Hash-consing keeps
+    // this at zero; anything else breaks the memo and the step cache.
+    size_t duplicateNodes() const {
+        std::unordered_map<uint64_t, std::vector<NodeId>> seen;
+        size_t duplicates = 0;
+        NodeId count = nodeCount.load();
+        for (NodeId id = 2; id < count; id++) {
+            const HashNode& n = node(id);
+            std::vector<NodeId>& bucket = seen[hashChildren(n.nw, n.ne, n.sw, n.se)];
+            for (NodeId other : bucket) {
+                const HashNode& o = node(other);
+                if (o.nw == n.nw && o.ne == n.ne && o.sw == n.sw && o.se == n.se) { duplicates++; break; }
+            }
+            bucket.push_back(id);
+        }
+        return duplicates;
+    }
+    int threads() const { return pool ? pool->threads() : 1; }
+    size_t memoryBytes() const { return memoryUsed(); }
+};
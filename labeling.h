@@ -0,0 +1,201 @@
+#pragma once
+
+#include "task_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#define LABEL_TILE 64  // tile mask granularity and band height; one word wide
+
+struct Component {
+    int x0, y0, x1, y1;  // bounding box, inclusive
+    int population;
+};
+
+// Packs one byte per cell (nonzero = alive) into rows of 64-bit words, bit
+// x % 64 of word x / 64 being cell x.
+inline void packCells(const uint8_t* cells, int width, int height, uint64_t* words) {
+    int wordsPerRow = (width + 63) / 64;
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = cells + size_t(y) * width;
+        for (int w = 0; w < wordsPerRow; w++) {
+            uint64_t word = 0;
+            for (int b = 0; b < 64 && w * 64 + b < width; b++) word |= uint64_t(row[w * 64 + b] != 0) << b;
+            words[size_t(y) * wordsPerRow + w] = word;
+        }
+    }
+}
+
+// 8-connected components of the live cells of a bit-packed grid.
+//
+// The grid is cut into bands of LABEL_TILE rows that are labeled in parallel,
+// each with its own union-find over global cell indices, so bands never touch
+// each other's entries. The seams between bands are then merged on one
+// thread, which costs a row per band. Component numbers are handed out per
+// band from a prefix sum, and bounding boxes are gathered per band as well:
+// a band writes the components rooted in it directly and keeps the few that
+// reach down from above in a side table merged at the end.
+class ComponentLabeler {
+private:
+    int width, height, wordsPerRow, tilesX, bands;
+    std::vector<uint32_t> parent;     // union-find, then the number of each root
+    std::vector<uint32_t> component;  // root, then component number of every labeled live cell
+    std::vector<uint32_t> firstComponent;  // per band, then the total
+    std::vector<std::unordered_map<uint32_t, Component>> spill;
+    const uint64_t* words;
+    const uint8_t* mask;
+    TaskPool* pool;
+
+    bool live(int x, int y) const {
+        if (x < 0 || y < 0 || x >= width || y >= height) return false;
+        if (mask && !mask[(y / LABEL_TILE) * tilesX + x / LABEL_TILE]) return false;
+        return (words[size_t(y) * wordsPerRow + (x >> 6)] >> (x & 63)) & 1;
+    }
+
+    uint32_t find(uint32_t i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    }
+
+    // Leaves the smaller index as root, so every root is its component's
+    // first cell in raster order.
+    void unite(uint32_t a, uint32_t b) {
+        a = find(a);
+        b = find(b);
+        if (a != b) parent[std::max(a, b)] = std::min(a, b);
+    }
+
+    template <typename F>
+    void forEachBand(F f) {
+        if (pool) {
+            TaskGroup group(*pool);
+            for (int band = 0; band < bands; band++) group.run([&f, band] { f(band); });
+            group.wait();
+        } else {
+            for (int band = 0; band < bands; band++) f(band);
+        }
+    }
+
+    template <typename F>
+    void forEachCellInRows(int y0, int y1, F f) const {
+        for (int y = y0; y < y1; y++) {
+            for (int w = 0; w < wordsPerRow; w++) {
+                if (mask && !mask[(y / LABEL_TILE) * tilesX + w]) continue;
+                for (uint64_t bits = words[size_t(y) * wordsPerRow + w]; bits; bits &= bits - 1) f(w * 64 + __builtin_ctzll(bits), y);
+            }
+        }
+    }
+
+    template <typename F>
+    void forEachCellInBand(int band, F f) const {
+        forEachCellInRows(band * LABEL_TILE, std::min(height, (band + 1) * LABEL_TILE), f);
+    }
+
+    uint32_t index(int x, int y) const { return uint32_t(size_t(y) * width + x); }
+
+    static void include(Component& c, int x, int y) {
+        c.x0 = std::min(c.x0, x);
+        c.x1 = std::max(c.x1, x);
+        c.y0 = std::min(c.y0, y);
+        c.y1 = std::max(c.y1, y);
+        c.population++;
+    }
+
+public:
+    ComponentLabeler(int width, int height, int threads = 1)
+        : width(width), height(height), wordsPerRow((width + 63) / 64), tilesX((width + LABEL_TILE - 1) / LABEL_TILE),
+          bands((height + LABEL_TILE - 1) / LABEL_TILE), words(nullptr), mask(nullptr), pool(nullptr) {
+        parent.assign(size_t(width) * height, 0);
+        component.assign(size_t(width) * height, 0);
+        firstComponent.assign(bands + 1, 0);
+        spill.resize(bands);
+        if (threads > 1) pool = new TaskPool(threads);
+    }
+
+    ~ComponentLabeler() { delete pool; }
+
+    ComponentLabeler(const ComponentLabeler&) = delete;
+    ComponentLabeler& operator=(const ComponentLabeler&) = delete;
+
+    // Labels the live cells of packed rows; with a tile mask (one byte per
+    // LABEL_TILE square, row-major) cells in unmarked tiles count as dead.
+    // The words and mask are only read during the call.
+    void label(const uint64_t* packed, const uint8_t* tileMask, std::vector<Component>& components) {
+        words = packed;
+        mask = tileMask;
+        forEachBand([this](int band) {
+            int yEnd = std::min(height, (band + 1) * LABEL_TILE);
+            forEachCellInBand(band, [this](int x, int y) { parent[index(x, y)] = index(x, y); });
+            forEachCellInBand(band, [this, yEnd](int x, int y) {
+                if (live(x + 1, y)) unite(index(x, y), index(x + 1, y));
+                if (y + 1 >= yEnd) return;
+                for (int nx = x - 1; nx <= x + 1; nx++) {
+                    if (live(nx, y + 1)) unite(index(x, y), index(nx, y + 1));
+                }
+            });
+        });
+        for (int band = 1; band < bands; band++) {
+            forEachCellInRows(band * LABEL_TILE - 1, band * LABEL_TILE, [this](int x, int y) {
+                for (int nx = x - 1; nx <= x + 1; nx++) {
+                    if (live(nx, y + 1)) unite(index(x, y), index(nx, y + 1));
+                }
+            });
+        }
+
+        // Parent is only read from here on until the roots get their numbers.
+        forEachBand([this](int band) {
+            uint32_t roots = 0;
+            forEachCellInBand(band, [&](int x, int y) {
+                uint32_t i = index(x, y), r = i;
+                while (parent[r] != r) r = parent[r];
+                component[i] = r;
+                roots += r == i;
+            });
+            firstComponent[band + 1] = roots;
+        });
+        firstComponent[0] = 0;
+        for (int band = 0; band < bands; band++) firstComponent[band + 1] += firstComponent[band];
+        forEachBand([this](int band) {
+            uint32_t next = firstComponent[band];
+            forEachCellInBand(band, [&](int x, int y) {
+                if (component[index(x, y)] == index(x, y)) parent[index(x, y)] = next++;
+            });
+        });
+
+        components.assign(firstComponent[bands], Component{ width, height, -1, -1, 0 });
+        forEachBand([this, &components](int band) {
+            uint32_t first = firstComponent[band];
+            spill[band].clear();
+            forEachCellInBand(band, [&](int x, int y) {
+                uint32_t i = index(x, y), id = parent[component[i]];
+                component[i] = id;
+                if (id >= first) {
+                    include(components[id], x, y);
+                } else {
+                    auto it = spill[band].emplace(id, Component{ width, height, -1, -1, 0 }).first;
+                    include(it->second, x, y);
+                }
+            });
+        });
+        for (int band = 0; band < bands; band++) {
+            for (const auto& it : spill[band]) {
+                Component& c = components[it.first];
+                c.x0 = std::min(c.x0, it.second.x0);
+                c.y0 = std::min(c.y0, it.second.y0);
+                c.x1 = std::max(c.x1, it.second.x1);
+                c.y1 = std::max(c.y1, it.second.y1);
+                c.population += it.second.population;
+            }
+        }
+    }
+
+    // Component of a live cell that the last label() call covered.
+    uint32_t componentAt(int x, int y) const { return component[size_t(y) * width + x]; }
+
+    int threads() const { return pool ? pool->threads() : 1; }
+};
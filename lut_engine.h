@@ -0,0 +1,138 @@
+#pragma once
+
+#include "engine.h"
+#include "rule.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// Cells are grouped into 2x2 blocks stored as one nibble per byte:
+// bit 0 = top-left, bit 1 = top-right, bit 2 = bottom-left, bit 3 = bottom-right.
+// Four neighboring blocks form a 4x4 neighborhood whose 16 bits index a table
+// holding the next state of its central 2x2.
+inline int blockBit(int x, int y) { return (x & 1) | ((y & 1) << 1); }
+
+inline void buildBlockTable(Rule rule, uint8_t* table) {
+    for (int index = 0; index < 65536; index++) {
+        auto cell = [index](int x, int y) {
+            int block = (y >> 1) * 2 + (x >> 1);
+            return (index >> (block * 4 + blockBit(x, y))) & 1;
+        };
+        uint8_t result = 0;
+        for (int oy = 0; oy < 2; oy++) {
+            for (int ox = 0; ox < 2; ox++) {
+                int x = ox + 1, y = oy + 1, n = 0;
+                for (int dy = -1; dy <= 1; dy++) {
+                    for (int dx = -1; dx <= 1; dx++) {
+                        if (dx || dy) n += cell(x + dx, y + dy);
+                    }
+                }
+                bool alive = cell(x, y) ? (rule.survive >> n) & 1 : (rule.birth >> n) & 1;
+                if (alive) result |= 1 << blockBit(ox, oy);
+            }
+        }
+        table[index] = result;
+    }
+}
+
+inline int blockIndex(uint8_t nw, uint8_t ne, uint8_t sw, uint8_t se) {
+    return nw | (ne << 4) | (sw << 8) | (se << 12);
+}
+
+// Block grids alternate alignment each generation: in phase 0 block (i, j)
+// covers cells (2i, 2j)..(2i+1, 2j+1), in phase 1 it is offset by one cell
+// diagonally. Each step therefore reads four aligned blocks and writes one,
+// with no per-cell work and a single wrapped column per row. The lattice is
+// a torus of even size; the dead boundary adds a cleared margin.
+class LutEngine : public Engine {
+private:
+    int width, height, gridWidth, gridHeight, blocksX, blocksY;
+    Boundary boundary;
+    std::vector<uint8_t> table;
+    std::vector<uint8_t> blocks[2];
+    int current, phase;
+
+    size_t blockOffset(int x, int y, int& bit) const {
+        int ox = x - phase, oy = y - phase;
+        if (ox < 0) ox += gridWidth;
+        if (oy < 0) oy += gridHeight;
+        bit = blockBit(ox, oy);
+        return size_t(oy >> 1) * blocksX + (ox >> 1);
+    }
+
+    void clearMargin() {
+        for (int y = 0; y < gridHeight; y++) {
+            for (int x = y < height ? width : 0; x < gridWidth; x++) {
+                int bit;
+                size_t offset = blockOffset(x, y, bit);
+                blocks[current][offset] &= ~(1 << bit);
+            }
+        }
+    }
+
+public:
+    LutEngine(int width, int height, Rule rule, Boundary boundary)
+        : width(width), height(height), boundary(boundary), table(65536), current(0), phase(0) {
+        gridWidth = boundary == Boundary::Torus ? width : (width + 2) & ~1;
+        gridHeight = boundary == Boundary::Torus ? height : (height + 2) & ~1;
+        if ((gridWidth | gridHeight) & 1) std::cerr << "LUT engine needs an even torus, got " << width << "x" << height << "\n";
+        blocksX = gridWidth / 2;
+        blocksY = gridHeight / 2;
+        buildBlockTable(rule, table.data());
+        for (int i = 0; i < 2; i++) blocks[i].assign(size_t(blocksX) * blocksY, 0);
+    }
+
+    static bool supports(int width, int height, Boundary boundary) {
+        return boundary == Boundary::Dead || (width % 2 == 0 && height % 2 == 0);
+    }
+
+    const char* name() const override { return "lut"; }
+
+    void load(const uint8_t* cells) override {
+        std::fill(blocks[current].begin(), blocks[current].end(), 0);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                if (!cells[y * width + x]) continue;
+                int bit;
+                size_t offset = blockOffset(x, y, bit);
+                blocks[current][offset] |= 1 << bit;
+            }
+        }
+    }
+
+    void store(uint8_t* cells) const override {
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                int bit;
+                size_t offset = blockOffset(x, y, bit);
+                cells[y * width + x] = (blocks[current][offset] >> bit) & 1 ? 255 : 0;
+            }
+        }
+    }
+
+    void step() override {
+        const uint8_t* src = blocks[current].data();
+        uint8_t* dst = blocks[1 - current].data();
+        const uint8_t* lut = table.data();
+        // Phase 0 reads blocks (i, j)..(i+1, j+1); phase 1 reads (i-1, j-1)..(i, j).
+        for (int j = 0; j < blocksY; j++) {
+            int j0 = phase == 0 ? j : (j + blocksY - 1) % blocksY;
+            int j1 = (j0 + 1) % blocksY;
+            const uint8_t* top = src + j0 * blocksX;
+            const uint8_t* bottom = src + j1 * blocksX;
+            uint8_t* out = dst + j * blocksX;
+            int first = phase == 0 ? 0 : 1, last = phase == 0 ? blocksX - 1 : blocksX;
+            for (int i = first; i < last; i++) {
+                int i0 = i - phase;
+                out[i] = lut[blockIndex(top[i0], top[i0 + 1], bottom[i0], bottom[i0 + 1])];
+            }
+            int wrap = phase == 0 ? blocksX - 1 : 0;
+            out[wrap] = lut[blockIndex(top[blocksX - 1], top[0], bottom[blocksX - 1], bottom[0])];
+        }
+        current = 1 - current;
+        phase = 1 - phase;
+        if (boundary == Boundary::Dead) clearMargin();
+    }
+};
@@ -0,0 +1,444 @@
+#pragma once
+
+#include "labeling.h"
+#include "rle.h"
+#include "rule.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#define TRACK_TILE LABEL_TILE  // the region is passed to the labeler as its tile mask
+#define TRACK_HISTORY 64  // twice the longest period that can be detected
+
+struct ObjectPhase {
+    uint64_t hash;   // cells relative to the bounding box corner
+    uint64_t shape;  // the same, minimized over the eight rotations and reflections
+    int x, y;
+    int population;
+};
+
+struct TrackedObject {
+    int x0, y0, x1, y1;  // bounding box, inclusive
+    int population;
+    uint64_t hash, shape;
+    uint64_t firstSeen;
+    ObjectPhase history[TRACK_HISTORY];  // ring, newest at index newest
+    int newest, historyLength;
+    int period, dx, dy;  // period 0 until two full periods were seen
+    bool catalogued;
+};
+
+struct CatalogueEntry {
+    uint64_t key;  // smallest phase shape: the same for every copy, phase and orientation
+    int period, dx, dy;  // dx >= dy >= 0
+    int population;  // of the phase that was recorded
+    uint64_t count;
+    uint64_t firstGeneration;
+    std::string rle;
+};
+
+// A spot that keeps launching the same spaceship the same way, such as a
+// glider gun. Guns are periodic, so each ship is confirmed at exactly the same
+// place and phase as the one before it.
+struct Emitter {
+    int x, y, dx, dy;  // where ships are confirmed, and their heading per period
+    uint64_t ship;     // catalogue key of the ship
+    uint64_t count;
+    uint64_t firstGeneration, lastGeneration;
+};
+
+inline uint64_t mixCell(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    return x ^ (x >> 33);
+}
+
+// Finds 8-connected objects, follows them from generation to generation and
+// records every one that repeats, with its period and displacement.
+//
+// Labeling is incremental: a 64x64 tile is only relabeled when its cells
+// changed since the last update or it borders one that did, together with
+// every object that reaches into such a tile. Objects elsewhere keep their
+// labels and histories untouched, so a soup that has mostly settled costs
+// little more than the packed comparison that finds the dirty tiles.
+class ObjectTracker {
+private:
+    int width, height, wordsPerRow, tilesX, tilesY;
+    Rule rule;
+    std::vector<uint64_t> current, previous;
+    std::vector<uint8_t> region;  // per tile: relabel this update
+    ComponentLabeler labeler;
+    std::vector<Component> components;
+    std::vector<std::vector<uint32_t>> tileObjects;  // replaced objects by the tiles their boxes cover
+    std::vector<TrackedObject> objects;
+    std::unordered_map<uint64_t, CatalogueEntry> entries;
+    std::unordered_map<uint64_t, Emitter> launches;  // every confirmed ship by launch site
+    uint64_t generation;
+    bool first;
+
+    bool alive(int x, int y) const {
+        return x >= 0 && y >= 0 && x < width && y < height && ((current[size_t(y) * wordsPerRow + (x >> 6)] >> (x & 63)) & 1);
+    }
+
+    bool tileChanged(int tx, int ty) const {
+        int w0 = tx * TRACK_TILE / 64;
+        for (int y = ty * TRACK_TILE; y < std::min(height, (ty + 1) * TRACK_TILE); y++) {
+            if (current[size_t(y) * wordsPerRow + w0] != previous[size_t(y) * wordsPerRow + w0]) return true;
+        }
+        return false;
+    }
+
+    // Marks changed tiles and their neighbors, then grows the region until no
+    // surviving object straddles its edge.
+    void markRegion() {
+        std::fill(region.begin(), region.end(), 0);
+        for (int ty = 0; ty < tilesY; ty++) {
+            for (int tx = 0; tx < tilesX; tx++) {
+                if (!first && !tileChanged(tx, ty)) continue;
+                for (int ny = std::max(0, ty - 1); ny <= std::min(tilesY - 1, ty + 1); ny++) {
+                    for (int nx = std::max(0, tx - 1); nx <= std::min(tilesX - 1, tx + 1); nx++) region[ny * tilesX + nx] = 1;
+                }
+            }
+        }
+        bool grew = true;
+        while (grew) {
+            grew = false;
+            for (const TrackedObject& o : objects) {
+                bool touches = false, inside = true;
+                for (int ty = o.y0 / TRACK_TILE; ty <= o.y1 / TRACK_TILE; ty++) {
+                    for (int tx = o.x0 / TRACK_TILE; tx <= o.x1 / TRACK_TILE; tx++) {
+                        if (region[ty * tilesX + tx]) touches = true;
+                        else inside = false;
+                    }
+                }
+                if (!touches || inside) continue;
+                for (int ty = o.y0 / TRACK_TILE; ty <= o.y1 / TRACK_TILE; ty++) {
+                    for (int tx = o.x0 / TRACK_TILE; tx <= o.x1 / TRACK_TILE; tx++) region[ty * tilesX + tx] = 1;
+                }
+                grew = true;
+            }
+        }
+    }
+
+    template <typename F>
+    void forEachRegionCell(F f) {
+        for (int ty = 0; ty < tilesY; ty++) {
+            for (int tx = 0; tx < tilesX; tx++) {
+                if (!region[ty * tilesX + tx]) continue;
+                int w = tx * TRACK_TILE / 64;
+                for (int y = ty * TRACK_TILE; y < std::min(height, (ty + 1) * TRACK_TILE); y++) {
+                    for (uint64_t bits = current[size_t(y) * wordsPerRow + w]; bits; bits &= bits - 1) {
+                        f(w * 64 + __builtin_ctzll(bits), y);
+                    }
+                }
+            }
+        }
+    }
+
+    // Connected components of the live cells inside the region.
+    std::vector<TrackedObject> labelRegion() {
+        labeler.label(current.data(), region.data(), components);
+        std::vector<TrackedObject> found(components.size(), TrackedObject{});
+        for (size_t i = 0; i < components.size(); i++) {
+            const Component& c = components[i];
+            found[i].x0 = c.x0;
+            found[i].y0 = c.y0;
+            found[i].x1 = c.x1;
+            found[i].y1 = c.y1;
+            found[i].population = c.population;
+        }
+        std::vector<uint64_t> shapes(found.size() * 8, 0);
+        forEachRegionCell([&](int x, int y) {
+            uint32_t index = labeler.componentAt(x, y);
+            TrackedObject& o = found[index];
+            uint64_t u = x - o.x0, v = y - o.y0, w = o.x1 - x, h = o.y1 - y;
+            uint64_t* s = &shapes[index * 8];
+            s[0] += mixCell(u << 32 | v);
+            s[1] += mixCell(w << 32 | v);
+            s[2] += mixCell(u << 32 | h);
+            s[3] += mixCell(w << 32 | h);
+            s[4] += mixCell(v << 32 | u);
+            s[5] += mixCell(h << 32 | u);
+            s[6] += mixCell(v << 32 | w);
+            s[7] += mixCell(h << 32 | w);
+        });
+        for (size_t i = 0; i < found.size(); i++) {
+            found[i].hash = shapes[i * 8];
+            found[i].shape = *std::min_element(&shapes[i * 8], &shapes[i * 8 + 8]);
+        }
+        return found;
+    }
+
+    // Visits the tile lists under an object's box grown by one cell.
+    template <typename F>
+    void forEachTile(const TrackedObject& o, F f) {
+        int tx0 = std::max(0, o.x0 - 1) / TRACK_TILE, tx1 = std::min(width - 1, o.x1 + 1) / TRACK_TILE;
+        int ty0 = std::max(0, o.y0 - 1) / TRACK_TILE, ty1 = std::min(height - 1, o.y1 + 1) / TRACK_TILE;
+        for (int ty = ty0; ty <= ty1; ty++) {
+            for (int tx = tx0; tx <= tx1; tx++) f(tileObjects[ty * tilesX + tx]);
+        }
+    }
+
+    static int overlap(const TrackedObject& a, const TrackedObject& b) {
+        // Ships move at most one cell per generation, so grow one box by one.
+        int w = std::min(a.x1 + 1, b.x1) - std::max(a.x0 - 1, b.x0) + 1;
+        int h = std::min(a.y1 + 1, b.y1) - std::max(a.y0 - 1, b.y0) + 1;
+        return w > 0 && h > 0 ? w * h : 0;
+    }
+
+    // The phase recorded `generations` generations before the newest one.
+    static const ObjectPhase& ago(const TrackedObject& o, int generations) {
+        return o.history[(o.newest - generations + TRACK_HISTORY) % TRACK_HISTORY];
+    }
+
+    // True if the last `period` phases each repeat the one `period` earlier,
+    // moved by the same offset: a full period seen twice. Debris of a few
+    // cells can pass that by accident while a reaction goes on around it, so
+    // short periods need a few more generations of evidence, and nothing may
+    // outrun light speed.
+    bool repeats(const TrackedObject& o, int period, int& dx, int& dy) const {
+        if (o.historyLength < std::max(2 * period, 6)) return false;
+        dx = ago(o, 0).x - ago(o, period).x;
+        dy = ago(o, 0).y - ago(o, period).y;
+        if (std::abs(dx) > period || std::abs(dy) > period) return false;
+        for (int i = 0; i < std::max(period, 6 - period); i++) {
+            const ObjectPhase &now = ago(o, i), &past = ago(o, i + period);
+            if (now.hash != past.hash || now.population != past.population || now.x - past.x != dx || now.y - past.y != dy) return false;
+        }
+        return true;
+    }
+
+    void record(TrackedObject& o) {
+        ObjectPhase phase = { o.hash, o.shape, o.x0, o.y0, o.population };
+        o.newest = (o.newest + 1) % TRACK_HISTORY;
+        o.history[o.newest] = phase;
+        o.historyLength = std::min(o.historyLength + 1, TRACK_HISTORY);
+        int dx, dy;
+        if (o.period) {
+            // Still repeating? Otherwise it collided or started evolving.
+            const ObjectPhase& past = ago(o, o.period);
+            if (past.hash == phase.hash && past.population == phase.population) return;
+            o.period = 0;
+            o.catalogued = false;
+        }
+        for (int p = 1; 2 * p <= o.historyLength; p++) {
+            if (!repeats(o, p, dx, dy)) continue;
+            o.period = p;
+            o.dx = dx;
+            o.dy = dy;
+            break;
+        }
+        if (o.period && !o.catalogued) catalogue(o);
+    }
+
+    void catalogue(TrackedObject& o) {
+        o.catalogued = true;
+        uint64_t key = o.shape;
+        for (int p = 1; p < o.period; p++) key = std::min(key, ago(o, p).shape);
+        if (o.dx || o.dy) launched(o, key);
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            it->second.count++;
+            return;
+        }
+        int w = o.x1 - o.x0 + 1, h = o.y1 - o.y0 + 1;
+        std::vector<uint8_t> cells(size_t(w) * h);
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) cells[size_t(y) * w + x] = alive(o.x0 + x, o.y0 + y) ? 255 : 0;
+        }
+        int dx = std::abs(o.dx), dy = std::abs(o.dy);
+        entries[key] = { key, o.period, std::max(dx, dy), std::min(dx, dy), o.population, 1, generation, writeRle(cells.data(), w, h, rule) };
+    }
+
+    void launched(const TrackedObject& o, uint64_t ship) {
+        uint64_t site = mixCell(ship ^ mixCell((uint64_t(uint32_t(o.x0)) << 32) | uint32_t(o.y0)) ^ mixCell((uint64_t(uint32_t(o.dx)) << 32) | uint32_t(o.dy)));
+        auto it = launches.find(site);
+        if (it == launches.end()) {
+            launches[site] = { o.x0, o.y0, o.dx, o.dy, ship, 1, generation, generation };
+            return;
+        }
+        it->second.count++;
+        it->second.lastGeneration = generation;
+    }
+
+    // Sweeps the box, widened by two cells to the sides for sparks, along the
+    // heading until it leaves the grid; only the leading row and column are
+    // new each step.
+    bool pathClear(const TrackedObject& o) const {
+        int sx = (o.dx > 0) - (o.dx < 0), sy = (o.dy > 0) - (o.dy < 0);
+        int x0 = o.x0 - (sx > 0 ? 0 : 2), x1 = o.x1 + (sx < 0 ? 0 : 2);
+        int y0 = o.y0 - (sy > 0 ? 0 : 2), y1 = o.y1 + (sy < 0 ? 0 : 2);
+        while (x1 >= 0 && y1 >= 0 && x0 < width && y0 < height) {
+            x0 += sx; x1 += sx;
+            y0 += sy; y1 += sy;
+            int edgeX = sx > 0 ? x1 : x0, edgeY = sy > 0 ? y1 : y0;
+            for (int y = y0; sx && y <= y1; y++) if (alive(edgeX, y)) return false;
+            for (int x = x0; sy && x <= x1; x++) if (alive(x, edgeY)) return false;
+        }
+        return true;
+    }
+
+public:
+    ObjectTracker(int width, int height, Rule rule, int threads = 1)
+        : width(width), height(height), wordsPerRow((width + 63) / 64), rule(rule), labeler(width, height, threads),
+          generation(0), first(true) {
+        tilesX = (width + TRACK_TILE - 1) / TRACK_TILE;
+        tilesY = (height + TRACK_TILE - 1) / TRACK_TILE;
+        current.assign(size_t(wordsPerRow) * height, 0);
+        previous = current;
+        region.assign(size_t(tilesX) * tilesY, 0);
+        tileObjects.resize(size_t(tilesX) * tilesY);
+    }
+
+    // Cells are one byte each, nonzero = alive; objects wrapping across a
+    // torus edge are seen as separate pieces.
+    void update(const uint8_t* cells, uint64_t atGeneration) {
+        std::swap(current, previous);
+        packCells(cells, width, height, current.data());
+        generation = atGeneration;
+        markRegion();
+        first = false;
+
+        // Objects lie wholly inside or outside the region; the ones outside
+        // did not change and only log another identical phase, which a still
+        // life does not even need.
+        auto gone = std::partition(objects.begin(), objects.end(), [this](const TrackedObject& o) {
+            return !region[(o.y0 / TRACK_TILE) * tilesX + o.x0 / TRACK_TILE];
+        });
+        for (auto it = objects.begin(); it != gone; ++it) {
+            if (it->period != 1) record(*it);
+        }
+
+        std::vector<TrackedObject> found = labelRegion();
+        std::vector<bool> claimed(objects.end() - gone, false);
+        for (size_t i = 0; i < claimed.size(); i++) {
+            forEachTile(gone[i], [&](std::vector<uint32_t>& list) { list.push_back(i); });
+        }
+        for (TrackedObject& o : found) {
+            int best = -1, bestOverlap = 0;
+            forEachTile(o, [&](std::vector<uint32_t>& list) {
+                for (uint32_t i : list) {
+                    int area = claimed[i] ? 0 : overlap(gone[i], o);
+                    if (area > bestOverlap) { bestOverlap = area; best = int(i); }
+                }
+            });
+            if (best >= 0) {
+                // Same object one generation on: carry its history over.
+                const TrackedObject& old = gone[best];
+                claimed[best] = true;
+                std::copy(old.history, old.history + TRACK_HISTORY, o.history);
+                o.newest = old.newest;
+                o.historyLength = old.historyLength;
+                o.firstSeen = old.firstSeen;
+                o.period = old.period;
+                o.dx = old.dx;
+                o.dy = old.dy;
+                o.catalogued = old.catalogued;
+            } else {
+                o.firstSeen = generation;
+            }
+            record(o);
+        }
+        for (auto it = gone; it != objects.end(); ++it) forEachTile(*it, [](std::vector<uint32_t>& list) { list.clear(); });
+        objects.erase(gone, objects.end());
+        objects.insert(objects.end(), found.begin(), found.end());
+    }
+
+    const std::vector<TrackedObject>& currentObjects() const { return objects; }
+    const std::unordered_map<uint64_t, CatalogueEntry>& catalogue() const { return entries; }
+
+    // Confirmed spaceships with nothing alive between them and the grid edge
+    // ahead. On a torus they would wrap into the soup from the other side;
+    // removing them first keeps the result as if the grid were unbounded.
+    std::vector<const TrackedObject*> escapingShips() const {
+        std::vector<const TrackedObject*> result;
+        for (const TrackedObject& o : objects) {
+            if (o.period && (o.dx || o.dy) && pathClear(o)) result.push_back(&o);
+        }
+        return result;
+    }
+
+    // Live cells of a current object, so it can be erased without touching
+    // neighbours that sit inside its box. The box is flood-filled piece by
+    // piece and the piece with the object's box, population and hash wins.
+    std::vector<std::pair<int, int>> objectCells(const TrackedObject& o) const {
+        int w = o.x1 - o.x0 + 1, h = o.y1 - o.y0 + 1;
+        std::vector<uint8_t> seen(size_t(w) * h, 0);
+        std::vector<std::pair<int, int>> cells, stack;
+        for (int sy = o.y0; sy <= o.y1; sy++) {
+            for (int sx = o.x0; sx <= o.x1; sx++) {
+                if (seen[size_t(sy - o.y0) * w + (sx - o.x0)] || !alive(sx, sy)) continue;
+                cells.clear();
+                stack.assign(1, { sx, sy });
+                seen[size_t(sy - o.y0) * w + (sx - o.x0)] = 1;
+                int x0 = sx, y0 = sy, x1 = sx, y1 = sy;
+                while (!stack.empty()) {
+                    auto cell = stack.back();
+                    stack.pop_back();
+                    cells.push_back(cell);
+                    x0 = std::min(x0, cell.first);
+                    x1 = std::max(x1, cell.first);
+                    y1 = std::max(y1, cell.second);
+                    for (int y = std::max(o.y0, cell.second - 1); y <= std::min(o.y1, cell.second + 1); y++) {
+                        for (int x = std::max(o.x0, cell.first - 1); x <= std::min(o.x1, cell.first + 1); x++) {
+                            uint8_t& mark = seen[size_t(y - o.y0) * w + (x - o.x0)];
+                            if (mark || !alive(x, y)) continue;
+                            mark = 1;
+                            stack.push_back({ x, y });
+                        }
+                    }
+                }
+                if (x0 != o.x0 || y0 != o.y0 || x1 != o.x1 || y1 != o.y1 || int(cells.size()) != o.population) continue;
+                uint64_t hash = 0;
+                for (const auto& cell : cells) hash += mixCell(uint64_t(cell.first - o.x0) << 32 | uint64_t(cell.second - o.y0));
+                if (hash == o.hash) return cells;
+            }
+        }
+        return {};
+    }
+
+    // Sum over the current objects of their shape hashes: the same for two
+    // grids holding the same objects anywhere and in any orientation.
+    uint64_t censusHash() const {
+        uint64_t hash = 0;
+        for (const TrackedObject& o : objects) hash += mixCell(o.shape);
+        return hash;
+    }
+
+    // Launch sites that produced at least two identical ships.
+    std::vector<Emitter> emitters() const {
+        std::vector<Emitter> result;
+        for (const auto& it : launches) if (it.second.count >= 2) result.push_back(it.second);
+        return result;
+    }
+
+    // Catalogue entries matching a filter, most common first.
+    template <typename Filter>
+    std::vector<const CatalogueEntry*> search(Filter filter) const {
+        std::vector<const CatalogueEntry*> result;
+        for (const auto& it : entries) if (filter(it.second)) result.push_back(&it.second);
+        std::sort(result.begin(), result.end(), [](const CatalogueEntry* a, const CatalogueEntry* b) { return a->count > b->count; });
+        return result;
+    }
+
+    void writeCatalogue(std::ostream& out) const {
+        for (const CatalogueEntry* e : search([](const CatalogueEntry&) { return true; })) {
+            const char* kind = e->dx || e->dy ? "spaceship" : e->period == 1 ? "still life" : "oscillator";
+            out << "#C " << kind << " p" << e->period << " (" << e->dx << "," << e->dy << ") pop " << e->population
+                << " seen " << e->count << " first at " << e->firstGeneration << "\n" << e->rle;
+        }
+        for (const Emitter& e : emitters()) {
+            const CatalogueEntry& ship = entries.at(e.ship);
+            out << "#C emitter at (" << e.x << "," << e.y << ") launching p" << ship.period << " pop " << ship.population
+                << " heading (" << e.dx << "," << e.dy << "): " << e.count << " ships, generations " << e.firstGeneration
+                << ".." << e.lastGeneration << "\n";
+        }
+    }
+};
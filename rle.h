@@ -0,0 +1,128 @@
+#pragma once
+
+#include "rule.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Extended RLE as used by most pattern collections: an optional
+// "x = w, y = h, rule = ..." header, '#' comment lines, then runs of 'b'
+// (dead) and 'o' (alive) separated by '$' row ends and closed by '!'.
+// Other letters are states of multi-state rules and read as alive.
+//
+// Patterns come from sockets and the clipboard, so sizes are capped before
+// anything is allocated: no side beyond RLE_MAX_SIDE, no more than
+// RLE_MAX_CELLS cells in all.
+#define RLE_MAX_SIDE 65536
+#define RLE_MAX_CELLS (1 << 26)
+
+inline bool rleSizeOk(long long width, long long height) {
+    return width >= 0 && height >= 0 && width <= RLE_MAX_SIDE && height <= RLE_MAX_SIDE && width * height <= RLE_MAX_CELLS;
+}
+
+struct RlePattern {
+    int width, height;
+    std::vector<uint8_t> cells;  // row-major, 0 or 255
+    bool hasRule;
+    Rule rule;
+};
+
+inline bool parseRle(const std::string& text, RlePattern& pattern) {
+    pattern.width = pattern.height = 0;
+    pattern.cells.clear();
+    pattern.hasRule = false;
+    std::vector<std::pair<int, int>> alive;
+    int x = 0, y = 0, run = 0, headerWidth = 0, headerHeight = 0;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string::npos) end = text.size();
+        std::string line = text.substr(pos, end - pos);
+        pos = end + 1;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        if (line[first] == 'x') {
+            if (sscanf(line.c_str() + first, "x = %d , y = %d", &headerWidth, &headerHeight) != 2) return false;
+            if (!rleSizeOk(headerWidth, headerHeight)) return false;
+            size_t ruleAt = line.find("rule");
+            if (ruleAt != std::string::npos) {
+                size_t value = line.find_first_not_of(" =", ruleAt + 4);
+                std::string name = value == std::string::npos ? "" : line.substr(value);
+                while (!name.empty() && isspace((unsigned char)name.back())) name.pop_back();
+                pattern.hasRule = parseRule(name.c_str(), pattern.rule);
+            }
+            continue;
+        }
+        for (size_t i = first; i < line.size(); i++) {
+            char c = line[i];
+            if (isdigit((unsigned char)c)) {
+                run = run * 10 + (c - '0');
+                if (run > RLE_MAX_SIDE) return false;
+                continue;
+            }
+            int count = run ? run : 1;
+            run = 0;
+            if (c == '!') {
+                pos = text.size();
+                break;
+            } else if (c == '$') {
+                y += count;
+                x = 0;
+            } else if (c == 'b' || c == '.') {
+                x += count;
+            } else if (isalpha((unsigned char)c)) {
+                for (int k = 0; k < count; k++) alive.push_back({ x++, y });
+            } else if (!isspace((unsigned char)c)) {
+                return false;
+            }
+            pattern.width = std::max(pattern.width, x);
+            if (!rleSizeOk(pattern.width, y)) return false;
+        }
+    }
+    for (const auto& cell : alive) pattern.height = std::max(pattern.height, cell.second + 1);
+    pattern.width = std::max(pattern.width, headerWidth);
+    pattern.height = std::max(pattern.height, headerHeight);
+    if (!rleSizeOk(pattern.width, pattern.height)) return false;
+    pattern.cells.assign(size_t(pattern.width) * pattern.height, 0);
+    for (const auto& cell : alive) pattern.cells[size_t(cell.second) * pattern.width + cell.first] = 255;
+    return true;
+}
+
+// Writes cells (nonzero = alive) as RLE with lines of at most 70 characters.
+inline std::string writeRle(const uint8_t* cells, int width, int height, Rule rule) {
+    std::string out = "x = " + std::to_string(width) + ", y = " + std::to_string(height) + ", rule = " + ruleString(rule) + "\n";
+    std::string body;
+    size_t lineStart = 0;
+    auto emit = [&](int count, char tag) {
+        std::string item = (count > 1 ? std::to_string(count) : std::string()) + tag;
+        if (body.size() - lineStart + item.size() > 70) {
+            body += '\n';
+            lineStart = body.size();
+        }
+        body += item;
+    };
+    int pendingRows = 0;
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = cells + size_t(y) * width;
+        int end = width;
+        while (end > 0 && !row[end - 1]) end--;
+        if (end == 0) {
+            pendingRows++;
+            continue;
+        }
+        if (pendingRows) emit(pendingRows, '$');
+        pendingRows = 0;
+        for (int x = 0; x < end;) {
+            int start = x;
+            while (x < end && (row[x] != 0) == (row[start] != 0)) x++;
+            emit(x - start, row[start] ? 'o' : 'b');
+        }
+        pendingRows = 1;
+    }
+    emit(1, '!');
+    return out + body + "\n";
+}
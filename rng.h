@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// xoshiro256** seeded through splitmix64. Both are fully specified integer
+// recurrences, so a seed gives the same soup with any compiler and libc.
+inline uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+class Rng {
+private:
+    uint64_t s[4];
+
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+public:
+    Rng(uint64_t seed) {
+        for (uint64_t& word : s) word = splitmix64(seed);
+    }
+
+    uint64_t next() {
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    // True with the given probability, compared in 53-bit fixed point so no
+    // floating-point rounding differs between machines.
+    bool chance(double probability) {
+        uint64_t threshold = probability >= 1 ? uint64_t(1) << 53 : uint64_t(probability * double(uint64_t(1) << 53));
+        return (next() >> 11) < threshold;
+    }
+};
+
+// One byte per cell, 255 with the given density.
+inline void randomSoup(uint8_t* cells, size_t count, double density, uint64_t seed) {
+    Rng rng(seed);
+    for (size_t i = 0; i < count; i++) cells[i] = rng.chance(density) ? 255 : 0;
+}
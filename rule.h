@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Outer-totalistic rule: bit n of birth/survive is set when a dead/live cell
+// with n live neighbors is alive in the next generation.
+struct Rule {
+    uint16_t birth;
+    uint16_t survive;
+};
+
+constexpr Rule LIFE_RULE = { 1 << 3, (1 << 2) | (1 << 3) };
+
+constexpr bool operator==(Rule a, Rule b) { return a.birth == b.birth && a.survive == b.survive; }
+constexpr bool operator!=(Rule a, Rule b) { return !(a == b); }
+
+enum class Boundary { Torus, Dead };
+
+// Accepts "B3/S23", "b36/s23" and the older "23/3" survive/birth notation.
+inline bool parseRule(const std::string& text, Rule& rule) {
+    Rule parsed = { 0, 0 };
+    size_t slash = text.find('/');
+    if (slash == std::string::npos) return false;
+    std::string first = text.substr(0, slash), second = text.substr(slash + 1);
+    std::string birth, survive;
+    if (!first.empty() && (first[0] == 'B' || first[0] == 'b')) {
+        if (second.empty() || (second[0] != 'S' && second[0] != 's')) return false;
+        birth = first.substr(1);
+        survive = second.substr(1);
+    } else {
+        survive = first;
+        birth = second;
+    }
+    for (char c : birth) {
+        if (c < '0' || c > '8') return false;
+        parsed.birth |= 1 << (c - '0');
+    }
+    for (char c : survive) {
+        if (c < '0' || c > '8') return false;
+        parsed.survive |= 1 << (c - '0');
+    }
+    rule = parsed;
+    return true;
+}
+
+inline std::string ruleString(Rule rule) {
+    std::string text = "B";
+    for (int n = 0; n <= 8; n++) if (rule.birth & (1 << n)) text += char('0' + n);
+    text += "/S";
+    for (int n = 0; n <= 8; n++) if (rule.survive & (1 << n)) text += char('0' + n);
+    return text;
+}
+
+inline bool parseBoundary(const std::string& text, Boundary& boundary) {
+    if (text == "torus") { boundary = Boundary::Torus; return true; }
+    if (text == "dead") { boundary = Boundary::Dead; return true; }
+    return false;
+}
+
+inline const char* boundaryName(Boundary boundary) {
+    return boundary == Boundary::Torus ? "torus" : "dead";
+}
+
+// Sum-of-products cover of a rule over the five inputs n0..n3 (bits of the
+// live neighbor count) and the cell's own state. A term matches when
+// (input & mask) == value. Counts 9..15 cannot occur and are don't-cares.
+#define RULE_VAR_ALIVE 4
+#define RULE_VAR_COUNT 5
+
+struct RuleTerm {
+    uint8_t value;
+    uint8_t mask;
+};
+
+struct RuleCover {
+    int count;
+    RuleTerm terms[32];
+};
+
+constexpr bool ruleMinterm(Rule rule, int input) {
+    int n = input & 15;
+    if (n > 8) return false;
+    return ((input >> RULE_VAR_ALIVE) & 1) ? ((rule.survive >> n) & 1) : ((rule.birth >> n) & 1);
+}
+
+constexpr bool ruleDontCare(int input) { return (input & 15) > 8; }
+
+constexpr bool termCovers(RuleTerm term, int input) { return (input & term.mask) == term.value; }
+
+constexpr int popcount5(int x) {
+    int c = 0;
+    for (int i = 0; i < RULE_VAR_COUNT; i++) c += (x >> i) & 1;
+    return c;
+}
+
+// Quine-McCluskey prime implicants followed by essential-then-greedy cover.
+// Small enough (3^5 candidate terms) to run in constant expressions.
+constexpr RuleCover minimizeRule(Rule rule) {
+    RuleTerm primes[243] = {};
+    int primeCount = 0;
+    RuleTerm current[243] = {};
+    int currentCount = 0;
+    for (int input = 0; input < 32; input++) {
+        if (ruleMinterm(rule, input) || ruleDontCare(input)) {
+            current[currentCount++] = { uint8_t(input), 31 };
+        }
+    }
+    while (currentCount > 0) {
+        RuleTerm next[243] = {};
+        int nextCount = 0;
+        bool merged[243] = {};
+        for (int i = 0; i < currentCount; i++) {
+            for (int j = i + 1; j < currentCount; j++) {
+                if (current[i].mask != current[j].mask) continue;
+                int diff = current[i].value ^ current[j].value;
+                if (popcount5(diff) != 1) continue;
+                merged[i] = merged[j] = true;
+                RuleTerm combined = { uint8_t(current[i].value & ~diff), uint8_t(current[i].mask & ~diff) };
+                bool seen = false;
+                for (int k = 0; k < nextCount; k++) {
+                    if (next[k].value == combined.value && next[k].mask == combined.mask) seen = true;
+                }
+                if (!seen) next[nextCount++] = combined;
+            }
+        }
+        for (int i = 0; i < currentCount; i++) {
+            if (merged[i]) continue;
+            bool useful = false;
+            for (int input = 0; input < 32; input++) {
+                if (termCovers(current[i], input) && ruleMinterm(rule, input)) useful = true;
+            }
+            if (useful) primes[primeCount++] = current[i];
+        }
+        for (int i = 0; i < nextCount; i++) current[i] = next[i];
+        currentCount = nextCount;
+    }
+
+    RuleCover cover = {};
+    bool covered[32] = {};
+    for (int input = 0; input < 32; input++) {
+        if (!ruleMinterm(rule, input) || covered[input]) continue;
+        int only = -1, hits = 0;
+        for (int p = 0; p < primeCount; p++) {
+            if (termCovers(primes[p], input)) { only = p; hits++; }
+        }
+        if (hits != 1) continue;
+        cover.terms[cover.count++] = primes[only];
+        for (int k = 0; k < 32; k++) if (termCovers(primes[only], k)) covered[k] = true;
+    }
+    while (true) {
+        int best = -1, bestGain = 0;
+        for (int p = 0; p < primeCount; p++) {
+            int gain = 0;
+            for (int input = 0; input < 32; input++) {
+                if (ruleMinterm(rule, input) && !covered[input] && termCovers(primes[p], input)) gain++;
+            }
+            if (gain > bestGain || (gain == bestGain && gain > 0 && popcount5(primes[p].mask) < popcount5(primes[best].mask))) {
+                best = p;
+                bestGain = gain;
+            }
+        }
+        if (best < 0) break;
+        cover.terms[cover.count++] = primes[best];
+        for (int k = 0; k < 32; k++) if (termCovers(primes[best], k)) covered[k] = true;
+    }
+    return cover;
+}
+
+constexpr bool coverUsesVar(const RuleCover& cover, int var) {
+    for (int i = 0; i < cover.count; i++) if (cover.terms[i].mask & (1 << var)) return true;
+    return false;
+}
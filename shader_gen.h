@@ -0,0 +1,239 @@
+#pragma once
+
+#include "rule.h"
+
+#include <string>
+
+// Builds the step compute shader for a rule. The neighbor count is split into
+// its bits and the rule becomes the minimized sum-of-products from
+// minimizeRule(), so B3/S23 compiles to (c0 & c1 & ~c2) | (c1 & ~c2 & a)
+// instead of a table lookup.
+inline std::string ruleExpression(Rule rule) {
+    RuleCover cover = minimizeRule(rule);
+    if (cover.count == 0) return "0u";
+    const char* names[RULE_VAR_COUNT] = { "c0", "c1", "c2", "c3", "a" };
+    std::string expr;
+    for (int i = 0; i < cover.count; i++) {
+        std::string term;
+        for (int v = 0; v < RULE_VAR_COUNT; v++) {
+            if (!(cover.terms[i].mask & (1 << v))) continue;
+            if (!term.empty()) term += " & ";
+            term += (cover.terms[i].value & (1 << v)) ? names[v] : std::string("~") + names[v];
+        }
+        if (term.empty()) term = "1u";
+        if (!expr.empty()) expr += " | ";
+        expr += "(" + term + ")";
+    }
+    return "(" + expr + ") & 1u";
+}
+
+#define GPU_TILE 16
+
+struct StepShaderConfig {
+    Rule rule;
+    Boundary boundary;
+    bool sparse;  // one workgroup per entry of the active tile list
+    bool heat;    // count state changes per cell in heatMap
+    bool damage;  // grow the Damage rectangle over every tile where a cell changed
+};
+
+// Both ping-pong textures stay bound to units 0 and 1 and the parity
+// uniform says which one holds the current generation, so a batch of
+// generations only changes one uniform between dispatches.
+inline std::string lifeComputeShader(const StepShaderConfig& config) {
+    // imageLoad outside the image returns zero, which is exactly the dead boundary.
+    std::string wrap = config.boundary == Boundary::Torus ? "(pos + ivec2(dx, dy) + size) % size" : "pos + ivec2(dx, dy)";
+    std::string source = R"(
+        #version 430 core
+        layout(local_size_x = 16, local_size_y = 16, local_size_z = 1) in;
+        layout(r8, binding = 0) uniform image2D grid0;
+        layout(r8, binding = 1) uniform image2D grid1;
+        uniform uint parity;  // 1 when grid1 is the current generation
+    )";
+    if (config.heat) {
+        source += R"(
+        layout(r8ui, binding = 2) uniform uimage2D heatMap;
+        )";
+    }
+    if (config.sparse) {
+        source += R"(
+        layout(std430, binding = 0) readonly buffer ActiveTiles { uint activeTiles[]; };
+        layout(std430, binding = 1) writeonly buffer ChangedTiles { uint changedTiles[]; };
+        )";
+    }
+    if (config.damage) {
+        source += R"(
+        layout(std430, binding = 4) buffer Damage { int damage[4]; };  // x0, y0, x1, y1, exclusive
+        )";
+    }
+    bool tileFlag = config.sparse || config.damage;
+    if (tileFlag) {
+        source += R"(
+        shared uint tileChanged;
+        )";
+    }
+    source += R"(
+        uint cell(ivec2 pos, ivec2 size, int dx, int dy) {
+            ivec2 p = )" + wrap + R"(;
+            return (parity == 0u ? imageLoad(grid0, p).r : imageLoad(grid1, p).r) > 0.5 ? 1u : 0u;
+        }
+        void main() {
+            ivec2 size = imageSize(grid0);
+    )";
+    if (config.sparse) {
+        source += R"(
+            uint tile = activeTiles[gl_WorkGroupID.x];
+            uint tilesX = uint(size.x + 15) / 16u;
+            ivec2 origin = ivec2(tile % tilesX, tile / tilesX) * 16;
+        )";
+    } else {
+        source += R"(
+            ivec2 origin = ivec2(gl_WorkGroupID.xy) * 16;
+        )";
+    }
+    if (tileFlag) {
+        source += R"(
+            if (gl_LocalInvocationIndex == 0u) tileChanged = 0u;
+            barrier();
+        )";
+    }
+    source += R"(
+            ivec2 pos = origin + ivec2(gl_LocalInvocationID.xy);
+            if (pos.x < size.x && pos.y < size.y) {
+    )";
+    source += R"(
+            uint a = cell(pos, size, 0, 0);
+            uint n = cell(pos, size, -1, -1) + cell(pos, size, 0, -1) + cell(pos, size, 1, -1)
+                   + cell(pos, size, -1, 0) + cell(pos, size, 1, 0)
+                   + cell(pos, size, -1, 1) + cell(pos, size, 0, 1) + cell(pos, size, 1, 1);
+            uint c0 = n, c1 = n >> 1, c2 = n >> 2, c3 = n >> 3;
+            uint nextState = )" + ruleExpression(config.rule) + R"(;
+            if (parity == 0u) imageStore(grid1, pos, vec4(float(nextState), 0.0, 0.0, 1.0));
+            else imageStore(grid0, pos, vec4(float(nextState), 0.0, 0.0, 1.0));
+    )";
+    // Saturating 8-bit change counter. Only cells that flip touch the heat
+    // image, so a settled grid adds no traffic at all.
+    if (config.heat) {
+        source += R"(
+            if (nextState != a) {
+                uint heat = imageLoad(heatMap, pos).r;
+                if (heat < 255u) imageStore(heatMap, pos, uvec4(heat + 1u));
+            }
+        )";
+    }
+    if (!tileFlag) {
+        source += R"(
+            }
+        }
+        )";
+        return source;
+    }
+    source += R"(
+            if (nextState != a) atomicOr(tileChanged, 1u);
+            }
+            barrier();
+    )";
+    if (config.sparse) {
+        source += R"(
+            if (gl_LocalInvocationIndex == 0u) changedTiles[tile] = tileChanged;
+        )";
+    }
+    // One atomic per changed tile rather than per cell keeps a busy soup
+    // from serializing on four words.
+    if (config.damage) {
+        source += R"(
+            if (gl_LocalInvocationIndex == 0u && tileChanged != 0u) {
+                atomicMin(damage[0], origin.x);
+                atomicMin(damage[1], origin.y);
+                atomicMax(damage[2], min(origin.x + 16, size.x));
+                atomicMax(damage[3], min(origin.y + 16, size.y));
+            }
+        )";
+    }
+    source += R"(
+        }
+    )";
+    return source;
+}
+
+// Appends every tile that changed, or borders a tile that changed, to the
+// active list and counts it in the indirect dispatch command. Tiles left out
+// are unchanged in both ping-pong textures, so they need no work at all.
+inline std::string tileCompactionShader(Boundary boundary) {
+    std::string neighbor = boundary == Boundary::Torus
+        ? "ivec2 n = (t + ivec2(dx, dy) + tiles) % tiles;"
+        : "ivec2 n = t + ivec2(dx, dy); if (any(lessThan(n, ivec2(0))) || any(greaterThanEqual(n, tiles))) continue;";
+    return R"(
+        #version 430 core
+        layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+        layout(std430, binding = 0) writeonly buffer ActiveTiles { uint activeTiles[]; };
+        layout(std430, binding = 1) readonly buffer ChangedTiles { uint changedTiles[]; };
+        layout(std430, binding = 2) buffer Dispatch { uint numGroupsX; uint numGroupsY; uint numGroupsZ; };
+        uniform ivec2 tiles;
+        void main() {
+            uint index = gl_GlobalInvocationID.x;
+            if (index >= uint(tiles.x * tiles.y)) return;
+            ivec2 t = ivec2(int(index) % tiles.x, int(index) / tiles.x);
+            bool active = false;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    )" + neighbor + R"(
+                    if (changedTiles[n.y * tiles.x + n.x] != 0u) active = true;
+                }
+            }
+            if (active) activeTiles[atomicAdd(numGroupsX, 1u)] = index;
+        }
+    )";
+}
+
+// Writes a batch of single-cell edits into the current generation. Each edit
+// packs x into bits 0-14, y into bits 15-29 and the new state into bit 31,
+// so freehand drawing costs one small buffer upload instead of a rectangle.
+#define EDIT_COORD_BITS 15
+
+inline std::string editScatterShader() {
+    return R"(
+        #version 430 core
+        layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+        layout(r8, binding = 0) uniform writeonly image2D grid;
+        layout(std430, binding = 3) readonly buffer Edits { uint edits[]; };
+        uniform uint editCount;
+        void main() {
+            uint index = gl_GlobalInvocationID.x;
+            if (index >= editCount) return;
+            uint edit = edits[index];
+            ivec2 pos = ivec2(edit & 0x7FFFu, (edit >> 15) & 0x7FFFu);
+            imageStore(grid, pos, vec4(float(edit >> 31), 0.0, 0.0, 1.0));
+        }
+    )";
+}
+
+// The step kernel for the Vulkan engine: the same rule expression over two
+// storage buffers of one uint per cell, which set 0 binds as current and next
+// in either order, so a batch of generations only swaps descriptor sets.
+inline std::string vulkanStepShader(Rule rule, Boundary boundary) {
+    std::string fetch = boundary == Boundary::Torus
+        ? "ivec2 p = (pos + ivec2(dx, dy) + size) % size;"
+        : "ivec2 p = pos + ivec2(dx, dy); if (any(lessThan(p, ivec2(0))) || any(greaterThanEqual(p, size))) return 0u;";
+    return R"(
+        #version 450
+        layout(local_size_x = 16, local_size_y = 16, local_size_z = 1) in;
+        layout(std430, set = 0, binding = 0) readonly buffer Current { uint current[]; };
+        layout(std430, set = 0, binding = 1) writeonly buffer Next { uint next[]; };
+        layout(push_constant) uniform Grid { ivec2 size; };
+        uint cell(ivec2 pos, int dx, int dy) {
+            )" + fetch + R"(
+            return current[p.y * size.x + p.x];
+        }
+        void main() {
+            ivec2 pos = ivec2(gl_GlobalInvocationID.xy);
+            if (pos.x >= size.x || pos.y >= size.y) return;
+            uint a = cell(pos, 0, 0);
+            uint n = cell(pos, -1, -1) + cell(pos, 0, -1) + cell(pos, 1, -1)
+                   + cell(pos, -1, 0) + cell(pos, 1, 0)
+                   + cell(pos, -1, 1) + cell(pos, 0, 1) + cell(pos, 1, 1);
+            uint c0 = n, c1 = n >> 1, c2 = n >> 2, c3 = n >> 3;
+            next[pos.y * size.x + pos.x] = )" + ruleExpression(rule) + R"(;
+        }
+    )";
+}
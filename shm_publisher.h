@@ -0,0 +1,172 @@
+#pragma once
+
+#include "rule.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+#define SHM_MAGIC 0x474e49524546494cull  // "LIFERING" in memory order
+#define SHM_VERSION 2
+#define SHM_SLOTS 4
+
+// Shared segment: one header followed by SHM_SLOTS frames. Each frame is the
+// grid bit-packed into rows of 64-bit words, bit x % 64 of word x / 64 being
+// cell x. The n-th frame published goes to slot n % SHM_SLOTS, whatever its
+// generation, so batched or 2^k steps still rotate through every slot. The
+// writer fills it under that slot's seqlock, so it never waits; a reader
+// that races with it sees an odd or changed sequence and retries or moves to
+// a newer slot.
+struct ShmHeader {
+    uint64_t magic;
+    uint32_t version, slots;
+    uint32_t width, height;
+    uint32_t wordsPerRow;
+    uint16_t birth, survive;
+    uint64_t frameBytes;
+    std::atomic<uint64_t> latest;  // frames published so far; the newest is in slot (latest - 1) % slots
+};
+
+struct ShmSlot {
+    std::atomic<uint64_t> sequence;  // odd while the writer is inside
+    uint64_t generation;  // of the frame in this slot
+};
+
+inline size_t shmSlotBytes(const ShmHeader& header) { return sizeof(ShmSlot) + header.frameBytes; }
+inline size_t shmTotalBytes(const ShmHeader& header) { return sizeof(ShmHeader) + header.slots * shmSlotBytes(header); }
+
+class ShmPublisher {
+private:
+    std::string name;
+    ShmHeader* header;
+    size_t size;
+    uint64_t published;
+
+    ShmSlot* slot(uint64_t frame) {
+        return reinterpret_cast<ShmSlot*>(reinterpret_cast<char*>(header + 1) + (frame % SHM_SLOTS) * shmSlotBytes(*header));
+    }
+
+    // Brackets a frame write; the frame words are plain stores ordered by the fences.
+    uint64_t* beginFrame(uint64_t generation) {
+        ShmSlot* s = slot(published);
+        s->sequence.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s->generation = generation;
+        return reinterpret_cast<uint64_t*>(s + 1);
+    }
+
+    void endFrame() {
+        slot(published)->sequence.fetch_add(1, std::memory_order_release);
+        header->latest.store(++published, std::memory_order_release);
+    }
+
+public:
+    ShmPublisher(const std::string& name, int width, int height, Rule rule) : name(name), header(nullptr), size(0), published(0) {
+        ShmHeader layout = {};
+        layout.slots = SHM_SLOTS;
+        layout.wordsPerRow = (width + 63) / 64;
+        layout.frameBytes = size_t(layout.wordsPerRow) * height * sizeof(uint64_t);
+        size = shmTotalBytes(layout);
+        int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+        if (fd < 0) { std::cerr << "shm_open " << name << " failed\n"; return; }
+        if (ftruncate(fd, size) != 0) { std::cerr << "Could not size " << name << "\n"; close(fd); return; }
+        void* mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) { std::cerr << "mmap " << name << " failed\n"; return; }
+        memset(mapped, 0, size);
+        header = static_cast<ShmHeader*>(mapped);
+        header->version = SHM_VERSION;
+        header->slots = SHM_SLOTS;
+        header->width = width;
+        header->height = height;
+        header->wordsPerRow = layout.wordsPerRow;
+        header->birth = rule.birth;
+        header->survive = rule.survive;
+        header->frameBytes = layout.frameBytes;
+        // Readers check the magic last, after everything else is in place.
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = SHM_MAGIC;
+    }
+
+    ~ShmPublisher() {
+        if (!header) return;
+        munmap(header, size);
+        shm_unlink(name.c_str());
+    }
+
+    bool ok() const { return header != nullptr; }
+
+    // Publishes one byte per cell (nonzero = alive).
+    void publish(const uint8_t* cells, uint64_t generation) {
+        uint64_t* words = beginFrame(generation);
+        for (uint32_t y = 0; y < header->height; y++) {
+            const uint8_t* row = cells + size_t(y) * header->width;
+            uint64_t* out = words + size_t(y) * header->wordsPerRow;
+            for (uint32_t w = 0; w < header->wordsPerRow; w++) {
+                uint64_t word = 0;
+                uint32_t end = std::min<uint32_t>(64, header->width - w * 64);
+                for (uint32_t b = 0; b < end; b++) word |= uint64_t(row[w * 64 + b] != 0) << b;
+                out[w] = word;
+            }
+        }
+        endFrame();
+    }
+};
+
+// Consumer side, for tools that link this header rather than parse the layout.
+class ShmReader {
+private:
+    const ShmHeader* header;
+    size_t size;
+
+public:
+    ShmReader(const std::string& name) : header(nullptr), size(0) {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) { std::cerr << "No frames published at " << name << "\n"; return; }
+        off_t length = lseek(fd, 0, SEEK_END);
+        void* mapped = length >= off_t(sizeof(ShmHeader)) ? mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+        close(fd);
+        if (mapped == MAP_FAILED) { std::cerr << "mmap " << name << " failed\n"; return; }
+        header = static_cast<const ShmHeader*>(mapped);
+        size = length;
+        if (header->magic != SHM_MAGIC || header->version != SHM_VERSION || shmTotalBytes(*header) > size) {
+            std::cerr << name << " is not a frame ring\n";
+            munmap(mapped, size);
+            header = nullptr;
+        }
+    }
+
+    ~ShmReader() {
+        if (header) munmap(const_cast<ShmHeader*>(header), size);
+    }
+
+    bool ok() const { return header != nullptr; }
+    const ShmHeader& info() const { return *header; }
+
+    // Copies the newest complete frame. Returns false if nothing has been
+    // published yet; otherwise retries until it reads a slot the writer did
+    // not touch meanwhile, which only takes long if the reader is slower
+    // than SHM_SLOTS published frames.
+    bool readLatest(std::vector<uint64_t>& words, uint64_t& generation) const {
+        words.resize(header->frameBytes / sizeof(uint64_t));
+        while (true) {
+            uint64_t latest = header->latest.load(std::memory_order_acquire);
+            if (latest == 0) return false;
+            const ShmSlot* s = reinterpret_cast<const ShmSlot*>(reinterpret_cast<const char*>(header + 1)
+                                                                + ((latest - 1) % header->slots) * shmSlotBytes(*header));
+            uint64_t before = s->sequence.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            generation = s->generation;
+            memcpy(words.data(), s + 1, header->frameBytes);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s->sequence.load(std::memory_order_relaxed) == before) return true;
+        }
+    }
+};
@@ -0,0 +1,255 @@
+#pragma once
+
+#include "object_tracker.h"
+#include "rng.h"
+#include "rule.h"
+#include "task_pool.h"
+#include "tiled_engine.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+#define SWEEP_MAGIC "LIFESWP1"
+#define SWEEP_BLOCK_MAGIC 0x4b4c4253u  // "SBLK" in memory order
+#define SWEEP_BATCH 64
+#define SWEEP_MAX_PERIOD 64
+#define SWEEP_NEVER 0xffffffffu
+
+struct SweepParams {
+    uint32_t width, height;
+    Rule rule;
+    Boundary boundary;
+    double density;
+    uint32_t maxGenerations;
+};
+
+inline bool operator==(const SweepParams& a, const SweepParams& b) {
+    return a.width == b.width && a.height == b.height && a.rule == b.rule && a.boundary == b.boundary
+        && a.density == b.density && a.maxGenerations == b.maxGenerations;
+}
+
+struct SweepRecord {
+    uint64_t seed;
+    uint32_t stabilizedAt;  // first generation of the final cycle, SWEEP_NEVER if none was found
+    uint32_t population;    // at the last generation run
+    uint32_t period;        // of the final cycle, 0 if none
+    uint64_t census;        // ObjectTracker::censusHash of the last generation
+};
+
+// Sweep files are a header followed by blocks, each block one batch of seeds
+// stored column by column: seeds, stabilization generations, populations,
+// periods, census hashes, then a checksum over them. Values are in host byte
+// order. Blocks are only ever appended, so a crash can at worst leave a short
+// or corrupt last block; readers stop before it and the next run cuts it off.
+template <typename T>
+bool writeValues(FILE* file, const T* values, size_t count) { return fwrite(values, sizeof(T), count, file) == count; }
+
+template <typename T>
+bool readValues(FILE* file, T* values, size_t count) { return fread(values, sizeof(T), count, file) == count; }
+
+inline uint64_t sweepChecksum(const std::vector<SweepRecord>& records) {
+    uint64_t sum = records.size();
+    for (const SweepRecord& r : records) {
+        sum = mixCell(sum ^ r.seed);
+        sum = mixCell(sum ^ (uint64_t(r.stabilizedAt) << 32 | r.population));
+        sum = mixCell(sum ^ r.period);
+        sum = mixCell(sum ^ r.census);
+    }
+    return sum;
+}
+
+inline bool writeSweepHeader(FILE* file, const SweepParams& p) {
+    uint32_t fields[6] = { p.width, p.height, p.rule.birth, p.rule.survive, uint32_t(p.boundary), p.maxGenerations };
+    return writeValues(file, SWEEP_MAGIC, 8) && writeValues(file, fields, 6) && writeValues(file, &p.density, 1);
+}
+
+inline bool writeSweepBlock(FILE* file, const std::vector<SweepRecord>& records) {
+    uint32_t header[2] = { SWEEP_BLOCK_MAGIC, uint32_t(records.size()) };
+    std::vector<uint64_t> wide(records.size());
+    std::vector<uint32_t> narrow(records.size());
+    bool ok = writeValues(file, header, 2);
+    for (size_t i = 0; i < records.size(); i++) wide[i] = records[i].seed;
+    ok = ok && writeValues(file, wide.data(), wide.size());
+    for (size_t i = 0; i < records.size(); i++) narrow[i] = records[i].stabilizedAt;
+    ok = ok && writeValues(file, narrow.data(), narrow.size());
+    for (size_t i = 0; i < records.size(); i++) narrow[i] = records[i].population;
+    ok = ok && writeValues(file, narrow.data(), narrow.size());
+    for (size_t i = 0; i < records.size(); i++) narrow[i] = records[i].period;
+    ok = ok && writeValues(file, narrow.data(), narrow.size());
+    for (size_t i = 0; i < records.size(); i++) wide[i] = records[i].census;
+    ok = ok && writeValues(file, wide.data(), wide.size());
+    uint64_t checksum = sweepChecksum(records);
+    return ok && writeValues(file, &checksum, 1) && fflush(file) == 0;
+}
+
+// Reads every intact block. validBytes is where the intact part ends.
+inline bool readSweepFile(const std::string& path, SweepParams& p, std::vector<SweepRecord>& records, long& validBytes) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    char magic[8];
+    uint32_t fields[6];
+    if (!readValues(file, magic, 8) || memcmp(magic, SWEEP_MAGIC, 8) != 0 || !readValues(file, fields, 6) || !readValues(file, &p.density, 1)) {
+        std::cerr << path << " is not a sweep file\n";
+        fclose(file);
+        return false;
+    }
+    p.width = fields[0];
+    p.height = fields[1];
+    p.rule = Rule{ uint16_t(fields[2]), uint16_t(fields[3]) };
+    p.boundary = Boundary(fields[4]);
+    p.maxGenerations = fields[5];
+    records.clear();
+    validBytes = ftell(file);
+    uint32_t header[2];
+    while (readValues(file, header, 2) && header[0] == SWEEP_BLOCK_MAGIC) {
+        std::vector<SweepRecord> block(header[1]);
+        std::vector<uint64_t> wide(block.size());
+        std::vector<uint32_t> narrow(block.size());
+        uint64_t checksum;
+        if (!readValues(file, wide.data(), wide.size())) break;
+        for (size_t i = 0; i < block.size(); i++) block[i].seed = wide[i];
+        if (!readValues(file, narrow.data(), narrow.size())) break;
+        for (size_t i = 0; i < block.size(); i++) block[i].stabilizedAt = narrow[i];
+        if (!readValues(file, narrow.data(), narrow.size())) break;
+        for (size_t i = 0; i < block.size(); i++) block[i].population = narrow[i];
+        if (!readValues(file, narrow.data(), narrow.size())) break;
+        for (size_t i = 0; i < block.size(); i++) block[i].period = narrow[i];
+        if (!readValues(file, wide.data(), wide.size())) break;
+        for (size_t i = 0; i < block.size(); i++) block[i].census = wide[i];
+        if (!readValues(file, &checksum, 1) || checksum != sweepChecksum(block)) break;
+        records.insert(records.end(), block.begin(), block.end());
+        validBytes = ftell(file);
+    }
+    fclose(file);
+    return true;
+}
+
+// Runs random soups on the tiled engine until the grid repeats or the
+// generation cap is hit, one soup per pool task. A torus keeps escaping
+// gliders alive, so soups meant to settle are best run with a dead boundary.
+class SoupSweep {
+private:
+    SweepParams params;
+    TaskPool* pool;
+
+public:
+    SoupSweep(const SweepParams& params, int threads) : params(params), pool(nullptr) {
+        if (threads > 1) pool = new TaskPool(threads);
+    }
+
+    ~SoupSweep() { delete pool; }
+
+    SoupSweep(const SoupSweep&) = delete;
+    SoupSweep& operator=(const SoupSweep&) = delete;
+
+    SweepRecord runSeed(uint64_t seed) const {
+        std::vector<uint8_t> cells(size_t(params.width) * params.height);
+        randomSoup(cells.data(), cells.size(), params.density, seed);
+        TiledEngine engine(params.width, params.height, params.rule, params.boundary);
+        engine.load(cells.data());
+        SweepRecord record = { seed, SWEEP_NEVER, 0, 0, 0 };
+        uint64_t recent[SWEEP_MAX_PERIOD];
+        for (uint32_t generation = 0; generation <= params.maxGenerations; generation++) {
+            uint64_t hash = engine.stateHash();
+            for (uint32_t p = 1; p <= std::min<uint32_t>(generation, SWEEP_MAX_PERIOD); p++) {
+                if (recent[(generation - p) % SWEEP_MAX_PERIOD] != hash) continue;
+                record.period = p;
+                record.stabilizedAt = generation - p;
+                break;
+            }
+            if (record.period || generation == params.maxGenerations) break;
+            recent[generation % SWEEP_MAX_PERIOD] = hash;
+            engine.step();
+        }
+        engine.store(cells.data());
+        record.population = uint32_t(engine.population());
+        ObjectTracker census(params.width, params.height, params.rule);
+        census.update(cells.data(), 0);
+        record.census = census.censusHash();
+        return record;
+    }
+
+    // Runs the seeds in [first, last] that the file does not hold yet and
+    // appends their records a batch at a time.
+    bool run(const std::string& path, uint64_t first, uint64_t last) {
+        SweepParams existing;
+        std::vector<SweepRecord> done;
+        long validBytes = 0;
+        bool resuming = access(path.c_str(), F_OK) == 0;
+        if (resuming) {
+            if (!readSweepFile(path, existing, done, validBytes)) return false;
+            if (!(existing == params)) { std::cerr << path << " was written with other sweep settings\n"; return false; }
+            if (truncate(path.c_str(), validBytes) != 0) { std::cerr << "Could not truncate " << path << "\n"; return false; }
+        }
+        FILE* file = fopen(path.c_str(), resuming ? "ab" : "wb");
+        if (!file) { std::cerr << "Could not open " << path << "\n"; return false; }
+        if (!resuming && !writeSweepHeader(file, params)) { std::cerr << "Could not write " << path << "\n"; fclose(file); return false; }
+
+        // Seeds are drawn from the range a batch at a time, so a huge range
+        // costs no memory up front; only the seeds already in the file are held.
+        std::unordered_set<uint64_t> finished;
+        for (const SweepRecord& r : done) {
+            if (r.seed >= first && r.seed <= last) finished.insert(r.seed);
+        }
+        uint64_t toRun = last - first + 1 - finished.size(), ran = 0, seed = first;
+        std::cout << "Sweep: " << toRun << " seeds to run, " << finished.size() << " already in " << path << "\n";
+        bool ok = true, more = true;
+        std::vector<uint64_t> seeds;
+        while (ok && more) {
+            seeds.clear();
+            while (more && seeds.size() < SWEEP_BATCH) {
+                if (!finished.count(seed)) seeds.push_back(seed);
+                more = seed++ != last;
+            }
+            if (seeds.empty()) break;
+            std::vector<SweepRecord> batch(seeds.size());
+            auto runOne = [&](size_t i) { batch[i] = runSeed(seeds[i]); };
+            if (pool) {
+                TaskGroup group(*pool);
+                for (size_t i = 0; i < batch.size(); i++) group.run([&runOne, i] { runOne(i); });
+                group.wait();
+            } else {
+                for (size_t i = 0; i < batch.size(); i++) runOne(i);
+            }
+            ok = writeSweepBlock(file, batch);
+            ran += batch.size();
+            std::cout << "  " << ran << "/" << toRun << "\n";
+        }
+        if (fclose(file) != 0) ok = false;
+        if (!ok) std::cerr << "Could not write " << path << "\n";
+        return ok;
+    }
+};
+
+inline void writeSweepReport(const SweepParams& p, const std::vector<SweepRecord>& records, std::ostream& out) {
+    out << records.size() << " soups of " << p.width << "x" << p.height << " at density " << p.density << ", "
+        << ruleString(p.rule) << " " << boundaryName(p.boundary) << ", up to " << p.maxGenerations << " generations\n";
+    std::map<uint32_t, uint64_t> periods;
+    std::map<uint64_t, uint64_t> censuses;
+    uint64_t unsettled = 0;
+    for (const SweepRecord& r : records) {
+        if (r.stabilizedAt == SWEEP_NEVER) unsettled++;
+        else periods[r.period]++;
+        censuses[r.census]++;
+    }
+    out << "did not settle: " << unsettled << "\n";
+    for (const auto& it : periods) out << "period " << it.first << ": " << it.second << "\n";
+    out << "distinct final censuses: " << censuses.size() << "\n";
+
+    std::vector<const SweepRecord*> settled;
+    for (const SweepRecord& r : records) if (r.stabilizedAt != SWEEP_NEVER) settled.push_back(&r);
+    std::sort(settled.begin(), settled.end(), [](const SweepRecord* a, const SweepRecord* b) { return a->stabilizedAt > b->stabilizedAt; });
+    out << "longest lived:\n";
+    for (size_t i = 0; i < settled.size() && i < 10; i++) {
+        out << "  seed " << settled[i]->seed << ": settles at " << settled[i]->stabilizedAt << ", p" << settled[i]->period
+            << ", population " << settled[i]->population << "\n";
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded single-producer single-consumer ring. Each side owns one index and
+// only reads the other's, so push and pop never lock or wait; a full or
+// empty queue is reported to the caller instead.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+private:
+    T items[Capacity];
+    alignas(64) std::atomic<size_t> head;  // next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tail;  // next slot to push, written by the producer
+
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    bool push(T item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity) return false;
+        items[t & (Capacity - 1)] = std::move(item);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        item = std::move(items[h & (Capacity - 1)]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
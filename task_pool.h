@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fork-join pool. The thread that waits on a TaskGroup keeps running queued
+// tasks until its group is done, so nested groups never deadlock and a pool
+// of N threads uses N - 1 workers plus the caller.
+class TaskPool {
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> queue;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+
+    void workerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (stopping && queue.empty()) return;
+                task = std::move(queue.front());
+                queue.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    TaskPool(int threads) : stopping(false) {
+        for (int i = 1; i < threads; i++) workers.emplace_back(&TaskPool::workerLoop, this);
+    }
+
+    ~TaskPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    int threads() const { return int(workers.size()) + 1; }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+
+    // Runs the most recently queued task on the calling thread, if any.
+    bool runOne() {
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (queue.empty()) return false;
+            task = std::move(queue.back());
+            queue.pop_back();
+        }
+        task();
+        return true;
+    }
+};
+
+class TaskGroup {
+private:
+    TaskPool& pool;
+    std::atomic<int> pending;
+
+public:
+    TaskGroup(TaskPool& pool) : pool(pool), pending(0) {}
+    ~TaskGroup() { wait(); }
+
+    template <typename F>
+    void run(F f) {
+        pending++;
+        pool.submit([this, f] {
+            f();
+            pending--;
+        });
+    }
+
+    void wait() {
+        while (pending > 0) {
+            if (!pool.runOne()) std::this_thread::yield();
+        }
+    }
+};
@@ -0,0 +1,357 @@
+#pragma once
+
+#include "bitwise_engine.h"
+#include "engine.h"
+#include "rule.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#define TILE_SIZE 64
+#define AGAR_MAX_PERIOD 256
+
+// 64x64 cells as one 64-bit word per row, double buffered so a tile that is
+// skipped keeps its state without a copy.
+struct Tile {
+    uint64_t rows[2][TILE_SIZE];
+};
+
+struct TileMeta {
+    int tx, ty;
+    int validWidth, validHeight;
+    int neighbors[8];  // nw, n, ne, w, e, sw, s, se; -1 past a dead boundary
+    uint8_t current;
+    bool empty, changed;  // of the deviation from the background
+    uint16_t population;
+};
+
+inline uint32_t mortonCode(uint32_t x, uint32_t y) {
+    uint32_t code = 0;
+    for (int bit = 0; bit < 16; bit++) {
+        code |= ((x >> bit) & 1) << (2 * bit);
+        code |= ((y >> bit) & 1) << (2 * bit + 1);
+    }
+    return code;
+}
+
+inline int popcount64(uint64_t x) { return __builtin_popcountll(x); }
+
+// Tiles are stored in Z-order so the eight neighbors of a tile are mostly a
+// few KiB away. A tile is only recomputed when it or one of its neighbors
+// changed in the previous generation; row-major cells exist only in
+// load()/store().
+//
+// Tiles hold the XOR of the cells with a background, which is empty unless an
+// agar was set. An agar is a periodic pattern that tiles the torus; the
+// engine keeps every phase of one 64x64 tile of it. A tile whose deviation
+// and neighbors' deviations are all zero will match the next background
+// phase too and is skipped, so a pattern on an agar is as sparse as one on
+// an empty grid. With an agar of period above one, unchanged deviations do
+// not imply unchanged cells, so every other tile is stepped.
+class TiledEngine : public Engine {
+public:
+    typedef void (TiledEngine::*StepFn)();
+
+private:
+    int width, height, tilesX, tilesY;
+    Rule rule;
+    Boundary boundary;
+    std::vector<Tile> tiles;
+    std::vector<TileMeta> meta;
+    std::vector<int> tileAt;  // row-major tile coordinate -> Z-order index
+    std::vector<uint8_t> active;
+    StepFn stepFn;
+    std::vector<Tile> background;  // rows[0] of each phase; a single empty phase without an agar
+    int agarPhase;
+
+    int tileIndex(int tx, int ty) const {
+        if (boundary == Boundary::Torus) {
+            tx = (tx + tilesX) % tilesX;
+            ty = (ty + tilesY) % tilesY;
+        } else if (tx < 0 || ty < 0 || tx >= tilesX || ty >= tilesY) {
+            return -1;
+        }
+        return tileAt[ty * tilesX + tx];
+    }
+
+    const uint64_t* backgroundRows(int phase) const { return background[phase % background.size()].rows[0]; }
+
+    uint64_t neighborRow(int index, int row, const uint64_t* bg) const {
+        if (index < 0) return 0;
+        return tiles[index].rows[meta[index].current][row] ^ bg[row];
+    }
+
+    // Gathers rows -1..validHeight of a tile together with the cells just
+    // west and east of each row, then runs the adder network on whole words.
+    template <class Logic>
+    void stepTile(const Logic& logic, int index) {
+        const TileMeta& m = meta[index];
+        const uint64_t* own = tiles[index].rows[m.current];
+        uint64_t* out = tiles[index].rows[1 - m.current];
+        const int* nb = m.neighbors;
+        int vw = m.validWidth, vh = m.validHeight;
+        const uint64_t* bg = backgroundRows(agarPhase);
+        const uint64_t* bgNext = backgroundRows(agarPhase + 1);
+
+        uint64_t center[TILE_SIZE + 2], west[TILE_SIZE + 2], east[TILE_SIZE + 2];
+        // Rows above and below come from the last valid row of the north tiles
+        // and the first row of the south tiles; the west bit of a row is the
+        // last valid column of the west tile. Boundaries are encoded in the
+        // neighbor indices, so no kernel needs to know about them.
+        int northRow = nb[1] >= 0 ? meta[nb[1]].validHeight - 1 : 0;
+        int westShift = nb[3] >= 0 ? meta[nb[3]].validWidth - 1 : 0;
+        uint64_t mask = vw == TILE_SIZE ? ~uint64_t(0) : (uint64_t(1) << vw) - 1;
+        for (int r = -1; r <= vh; r++) {
+            uint64_t word, westWord, eastWord;
+            if (r < 0) {
+                word = neighborRow(nb[1], northRow, bg);
+                westWord = neighborRow(nb[0], northRow, bg);
+                eastWord = neighborRow(nb[2], northRow, bg);
+            } else if (r == vh) {
+                word = neighborRow(nb[6], 0, bg);
+                westWord = neighborRow(nb[5], 0, bg);
+                eastWord = neighborRow(nb[7], 0, bg);
+            } else {
+                word = own[r] ^ bg[r];
+                westWord = neighborRow(nb[3], r, bg);
+                eastWord = neighborRow(nb[4], r, bg);
+            }
+            word &= mask;  // the background runs past a narrow tile's last column
+            center[r + 1] = word;
+            west[r + 1] = (word << 1) | ((westWord >> westShift) & 1);
+            east[r + 1] = (word >> 1) | ((eastWord & 1) << (vw - 1));
+        }
+
+        bool changed = false;
+        int population = 0;
+        for (int r = 0; r < vh; r++) {
+            uint64_t c0, c1, c2, c3;
+            countNeighbors<uint64_t, Logic::NEED_BIT3>(west[r], center[r], east[r], west[r + 1], east[r + 1],
+                                                      west[r + 2], center[r + 2], east[r + 2], c0, c1, c2, c3);
+            uint64_t next = (logic.template next<uint64_t>(center[r + 1], c0, c1, c2, c3) ^ bgNext[r]) & mask;
+            changed |= next != own[r];
+            population += popcount64(next);
+            out[r] = next;
+        }
+        TileMeta& mm = meta[index];
+        mm.changed = changed;
+        mm.population = population;
+        mm.empty = population == 0;
+    }
+
+    bool neighborhoodEmpty(int index) const {
+        if (!meta[index].empty) return false;
+        for (int k = 0; k < 8; k++) {
+            int n = meta[index].neighbors[k];
+            if (n >= 0 && !meta[n].empty) return false;
+        }
+        return true;
+    }
+
+    // active[i]: 0 keeps the tile as is, 1 steps it, 2 clears it because
+    // its whole neighborhood matches the background, which the rule keeps
+    // evolving as the background: always for an agar, and for an empty one
+    // when the rule has no B0.
+    template <class Logic>
+    void stepWith() {
+        Logic logic(rule);
+        bool backgroundStays = !(rule.birth & 1) || hasAgar();
+        bool periodic = background.size() > 1;
+        for (size_t i = 0; i < meta.size(); i++) {
+            active[i] = meta[i].changed || periodic;
+            for (int k = 0; k < 8 && !active[i]; k++) {
+                int n = meta[i].neighbors[k];
+                if (n >= 0 && meta[n].changed) active[i] = 1;
+            }
+            if (active[i] && backgroundStays && neighborhoodEmpty(i)) active[i] = meta[i].empty && periodic ? 0 : 2;
+        }
+        for (size_t i = 0; i < meta.size(); i++) {
+            if (active[i] == 1) {
+                stepTile<Logic>(logic, i);
+                continue;
+            }
+            meta[i].changed = false;
+            if (active[i] == 2) {
+                uint64_t* out = tiles[i].rows[1 - meta[i].current];
+                std::fill(out, out + TILE_SIZE, 0);
+            }
+        }
+        for (size_t i = 0; i < meta.size(); i++) {
+            if (active[i]) meta[i].current = 1 - meta[i].current;
+        }
+        agarPhase = (agarPhase + 1) % background.size();
+    }
+
+    // Evolves a w x h torus of one byte per cell by one generation.
+    std::vector<uint8_t> evolveTorus(const std::vector<uint8_t>& cells, int w, int h) const {
+        std::vector<uint8_t> next(cells.size());
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                int n = 0;
+                for (int dy = -1; dy <= 1; dy++) {
+                    for (int dx = -1; dx <= 1; dx++) {
+                        if (dx || dy) n += cells[((y + dy + h) % h) * w + (x + dx + w) % w] != 0;
+                    }
+                }
+                bool alive = cells[y * w + x] != 0;
+                next[y * w + x] = (((alive ? rule.survive : rule.birth) >> n) & 1) ? 255 : 0;
+            }
+        }
+        return next;
+    }
+
+    static StepFn findStep(Rule rule) {
+#define TILED_STEP_FOR_RULE(B, S) \
+        if (rule == Rule{ B, S }) return &TiledEngine::stepWith<StaticRuleLogic<B, S>>;
+        FOR_EACH_COMPILED_RULE(TILED_STEP_FOR_RULE)
+#undef TILED_STEP_FOR_RULE
+        return &TiledEngine::stepWith<DynamicRuleLogic>;
+    }
+
+public:
+    TiledEngine(int width, int height, Rule rule, Boundary boundary)
+        : width(width), height(height), rule(rule), boundary(boundary) {
+        tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+        tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+        std::vector<std::pair<uint32_t, int>> order;
+        for (int ty = 0; ty < tilesY; ty++) {
+            for (int tx = 0; tx < tilesX; tx++) order.push_back({ mortonCode(tx, ty), ty * tilesX + tx });
+        }
+        std::sort(order.begin(), order.end());
+        tileAt.assign(tilesX * tilesY, 0);
+        meta.resize(order.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            tileAt[order[i].second] = i;
+            meta[i].tx = order[i].second % tilesX;
+            meta[i].ty = order[i].second / tilesX;
+        }
+        const int dx[8] = { -1, 0, 1, -1, 1, -1, 0, 1 }, dy[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+        for (TileMeta& m : meta) {
+            m.validWidth = std::min(TILE_SIZE, width - m.tx * TILE_SIZE);
+            m.validHeight = std::min(TILE_SIZE, height - m.ty * TILE_SIZE);
+            for (int k = 0; k < 8; k++) m.neighbors[k] = tileIndex(m.tx + dx[k], m.ty + dy[k]);
+            m.current = 0;
+            m.empty = true;
+            m.changed = true;
+            m.population = 0;
+        }
+        tiles.assign(meta.size(), Tile());
+        active.assign(meta.size(), 1);
+        stepFn = findStep(rule);
+        background.assign(1, Tile());
+        agarPhase = 0;
+    }
+
+    const char* name() const override { return "tiled"; }
+
+    void load(const uint8_t* cells) override {
+        const uint64_t* bg = backgroundRows(agarPhase);
+        for (size_t i = 0; i < meta.size(); i++) {
+            TileMeta& m = meta[i];
+            uint64_t* rows = tiles[i].rows[m.current];
+            uint64_t mask = m.validWidth == TILE_SIZE ? ~uint64_t(0) : (uint64_t(1) << m.validWidth) - 1;
+            int population = 0;
+            for (int r = 0; r < TILE_SIZE; r++) {
+                uint64_t word = 0;
+                if (r < m.validHeight) {
+                    const uint8_t* src = cells + size_t(m.ty * TILE_SIZE + r) * width + m.tx * TILE_SIZE;
+                    for (int c = 0; c < m.validWidth; c++) if (src[c]) word |= uint64_t(1) << c;
+                    word = (word ^ bg[r]) & mask;
+                }
+                rows[r] = word;
+                population += popcount64(word);
+            }
+            m.population = population;
+            m.empty = population == 0;
+            m.changed = true;
+        }
+    }
+
+    void store(uint8_t* cells) const override {
+        const uint64_t* bg = backgroundRows(agarPhase);
+        for (size_t i = 0; i < meta.size(); i++) {
+            const TileMeta& m = meta[i];
+            const uint64_t* rows = tiles[i].rows[m.current];
+            for (int r = 0; r < m.validHeight; r++) {
+                uint8_t* dst = cells + size_t(m.ty * TILE_SIZE + r) * width + m.tx * TILE_SIZE;
+                uint64_t word = rows[r] ^ bg[r];
+                for (int c = 0; c < m.validWidth; c++) dst[c] = (word >> c) & 1 ? 255 : 0;
+            }
+        }
+    }
+
+    // Sets a w x h agar, given as its phase at the current generation. Its
+    // size has to divide both 64 and the grid, on a torus, and it has to
+    // repeat within AGAR_MAX_PERIOD generations. The cells on the grid are
+    // kept as they are.
+    bool setAgar(const uint8_t* cells, int w, int h) {
+        if (boundary != Boundary::Torus) { std::cerr << "An agar needs a torus\n"; return false; }
+        if (w <= 0 || h <= 0 || TILE_SIZE % w || TILE_SIZE % h || width % w || height % h) {
+            std::cerr << "Agar size " << w << "x" << h << " must divide 64 and the grid size\n";
+            return false;
+        }
+        std::vector<std::vector<uint8_t>> phases(1, std::vector<uint8_t>(cells, cells + size_t(w) * h));
+        for (std::vector<uint8_t> next = evolveTorus(phases[0], w, h); next != phases[0]; next = evolveTorus(next, w, h)) {
+            if (phases.size() == AGAR_MAX_PERIOD) { std::cerr << "Agar does not repeat within " << AGAR_MAX_PERIOD << " generations\n"; return false; }
+            phases.push_back(next);
+        }
+        std::vector<uint8_t> grid(size_t(width) * height);
+        store(grid.data());
+        background.assign(phases.size(), Tile());
+        for (size_t t = 0; t < phases.size(); t++) {
+            for (int r = 0; r < TILE_SIZE; r++) {
+                uint64_t word = 0;
+                for (int c = 0; c < TILE_SIZE; c++) if (phases[t][(r % h) * w + c % w]) word |= uint64_t(1) << c;
+                background[t].rows[0][r] = word;
+            }
+        }
+        agarPhase = 0;
+        load(grid.data());
+        return true;
+    }
+
+    bool hasAgar() const {
+        if (background.size() > 1) return true;
+        for (uint64_t row : background[0].rows[0]) if (row) return true;
+        return false;
+    }
+
+    int agarPeriod() const { return int(background.size()); }
+
+    // The background alone at the current generation.
+    void storeBackground(uint8_t* cells) const {
+        const uint64_t* bg = backgroundRows(agarPhase);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) cells[size_t(y) * width + x] = (bg[y % TILE_SIZE] >> (x % TILE_SIZE)) & 1 ? 255 : 0;
+        }
+    }
+
+    void step() override { (this->*stepFn)(); }
+
+    // Live cells; with an agar, the cells that differ from it.
+    uint64_t population() const {
+        uint64_t total = 0;
+        for (const TileMeta& m : meta) total += m.population;
+        return total;
+    }
+
+    // Hash of the current cells (deviations, with an agar, plus its phase),
+    // for spotting a grid that repeats.
+    uint64_t stateHash() const {
+        uint64_t hash = agarPhase;
+        for (size_t i = 0; i < meta.size(); i++) {
+            if (meta[i].empty) continue;
+            const uint64_t* rows = tiles[i].rows[meta[i].current];
+            uint64_t tileHash = i + 1;
+            for (int r = 0; r < meta[i].validHeight; r++) tileHash = (tileHash ^ rows[r]) * 0x100000001b3ull + r;
+            hash += tileHash * 0x9e3779b97f4a7c15ull ^ (tileHash >> 29);
+        }
+        return hash;
+    }
+
+    int tileColumns() const { return tilesX; }
+    int tileRows() const { return tilesY; }
+    const TileMeta& tileMeta(int tx, int ty) const { return meta[tileAt[ty * tilesX + tx]]; }
+};
@@ -0,0 +1,448 @@
+#pragma once
+
+#include "engine.h"
+#include "rule.h"
+#include "shader_gen.h"
+
+#include <shaderc/shaderc.h>
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define VULKAN_BATCH 64         // generations in one pre-recorded batch; even, so a batch ends on the buffer it started from
+#define VULKAN_MAX_IN_FLIGHT 4  // submissions the host may queue ahead of the device
+
+static_assert(VULKAN_BATCH % 2 == 0, "a batch must not change which buffer holds the grid");
+
+// Steps the grid with a compute shader on a Vulkan 1.2 device, which may be
+// lavapipe on a machine without a GPU. A queue family without graphics is
+// preferred, so the work runs on the device's async compute queue.
+//
+// Cells live in two device-local buffers, one uint per cell, and the two
+// descriptor sets bind them as current/next in either order. Every command
+// buffer is recorded once, up front: one generation and a batch of
+// VULKAN_BATCH generations from either buffer, plus the copies to and from a
+// host-visible staging buffer. step() only counts. Counted generations go to
+// the queue a batch at a time, each submission signalling the next value of a
+// timeline semaphore, and the host waits on it only when it reads cells back.
+class VulkanEngine : public Engine {
+private:
+    int width, height;
+    Rule rule;
+    Boundary boundary;
+    VkInstance instance;
+    VkPhysicalDevice physicalDevice;
+    VkDevice device;
+    VkQueue queue;
+    uint32_t queueFamily;
+    VkBuffer cells[2], staging;
+    VkDeviceMemory cellMemory[2], stagingMemory;
+    uint32_t* stagingCells;
+    VkDescriptorSetLayout setLayout;
+    VkPipelineLayout pipelineLayout;
+    VkPipeline pipeline;
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSet sets[2];  // sets[p] reads cells[p] and writes cells[1 - p]
+    VkCommandPool commandPool;
+    VkCommandBuffer stepCommands[2], batchCommands[2], uploadCommands[2], downloadCommands[2];
+    VkSemaphore timeline;
+    bool valid;
+
+    // Reads flush queued steps, so the bookkeeping changes under store() too.
+    mutable uint64_t submitted;  // value the last submission signals
+    mutable int current;         // buffer holding the grid once everything submitted has run
+    mutable int queued;          // steps counted but not submitted yet
+
+    static bool check(VkResult result, const char* what) {
+        if (result == VK_SUCCESS) return true;
+        std::cerr << "Vulkan: " << what << " failed (" << result << ")\n";
+        return false;
+    }
+
+    // Index of a compute queue family, preferring one without graphics; -1 if none.
+    static int computeFamily(VkPhysicalDevice candidate) {
+        uint32_t count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(candidate, &count, nullptr);
+        std::vector<VkQueueFamilyProperties> families(count);
+        vkGetPhysicalDeviceQueueFamilyProperties(candidate, &count, families.data());
+        int family = -1;
+        for (uint32_t i = 0; i < count; i++) {
+            if (!(families[i].queueFlags & VK_QUEUE_COMPUTE_BIT)) continue;
+            if (!(families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)) return int(i);
+            if (family < 0) family = int(i);
+        }
+        return family;
+    }
+
+    bool createInstance() {
+        VkApplicationInfo app = {};
+        app.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        app.pApplicationName = "conway";
+        app.apiVersion = VK_API_VERSION_1_2;
+        VkInstanceCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        info.pApplicationInfo = &app;
+        return check(vkCreateInstance(&info, nullptr, &instance), "vkCreateInstance");
+    }
+
+    // Discrete GPUs first, then integrated ones, then anything else such as lavapipe.
+    bool pickDevice() {
+        uint32_t count = 0;
+        vkEnumeratePhysicalDevices(instance, &count, nullptr);
+        std::vector<VkPhysicalDevice> devices(count);
+        vkEnumeratePhysicalDevices(instance, &count, devices.data());
+        int bestScore = 0;
+        VkPhysicalDeviceProperties chosen = {};
+        for (VkPhysicalDevice candidate : devices) {
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(candidate, &properties);
+            VkPhysicalDeviceVulkan12Features features12 = {};
+            features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+            VkPhysicalDeviceFeatures2 features = {};
+            features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features.pNext = &features12;
+            if (properties.apiVersion < VK_API_VERSION_1_2) continue;
+            vkGetPhysicalDeviceFeatures2(candidate, &features);
+            int family = computeFamily(candidate);
+            if (!features12.timelineSemaphore || family < 0) continue;
+            int score = properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU ? 3
+                      : properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU ? 2 : 1;
+            if (score <= bestScore) continue;
+            bestScore = score;
+            physicalDevice = candidate;
+            queueFamily = uint32_t(family);
+            chosen = properties;
+        }
+        if (!physicalDevice) { std::cerr << "No Vulkan 1.2 device with compute and timeline semaphores\n"; return false; }
+        std::cout << "Vulkan device: " << chosen.deviceName << ", queue family " << queueFamily << "\n";
+        return true;
+    }
+
+    bool createDevice() {
+        float priority = 1.0f;
+        VkDeviceQueueCreateInfo queueInfo = {};
+        queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueInfo.queueFamilyIndex = queueFamily;
+        queueInfo.queueCount = 1;
+        queueInfo.pQueuePriorities = &priority;
+        VkPhysicalDeviceVulkan12Features features12 = {};
+        features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        features12.timelineSemaphore = VK_TRUE;
+        VkDeviceCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        info.pNext = &features12;
+        info.queueCreateInfoCount = 1;
+        info.pQueueCreateInfos = &queueInfo;
+        if (!check(vkCreateDevice(physicalDevice, &info, nullptr, &device), "vkCreateDevice")) return false;
+        vkGetDeviceQueue(device, queueFamily, 0, &queue);
+        return true;
+    }
+
+    bool createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& memory) {
+        VkBufferCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        info.size = size;
+        info.usage = usage;
+        info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (!check(vkCreateBuffer(device, &info, nullptr, &buffer), "vkCreateBuffer")) return false;
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(device, buffer, &requirements);
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+        uint32_t type = memoryProperties.memoryTypeCount;
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount && type == memoryProperties.memoryTypeCount; i++) {
+            if ((requirements.memoryTypeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) type = i;
+        }
+        if (type == memoryProperties.memoryTypeCount) { std::cerr << "Vulkan: no memory type for a buffer\n"; return false; }
+        VkMemoryAllocateInfo allocation = {};
+        allocation.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocation.allocationSize = requirements.size;
+        allocation.memoryTypeIndex = type;
+        return check(vkAllocateMemory(device, &allocation, nullptr, &memory), "vkAllocateMemory")
+            && check(vkBindBufferMemory(device, buffer, memory, 0), "vkBindBufferMemory");
+    }
+
+    bool createBuffers() {
+        VkDeviceSize bytes = VkDeviceSize(width) * height * sizeof(uint32_t);
+        VkBufferUsageFlags transfer = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        for (int i = 0; i < 2; i++) {
+            if (!createBuffer(bytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | transfer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, cells[i], cellMemory[i])) return false;
+        }
+        if (!createBuffer(bytes, transfer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging, stagingMemory)) return false;
+        void* mapped = nullptr;
+        if (!check(vkMapMemory(device, stagingMemory, 0, bytes, 0, &mapped), "vkMapMemory")) return false;
+        stagingCells = static_cast<uint32_t*>(mapped);
+        return true;
+    }
+
+    bool createPipeline() {
+        std::string source = vulkanStepShader(rule, boundary);
+        shaderc_compiler_t compiler = shaderc_compiler_initialize();
+        shaderc_compile_options_t options = shaderc_compile_options_initialize();
+        shaderc_compile_options_set_target_env(options, shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_2);
+        shaderc_compilation_result_t spirv = shaderc_compile_into_spv(compiler, source.c_str(), source.size(), shaderc_compute_shader, "step.comp", "main", options);
+        bool compiled = shaderc_result_get_compilation_status(spirv) == shaderc_compilation_status_success;
+        if (!compiled) std::cerr << "Shader Error: " << shaderc_result_get_error_message(spirv) << "\n";
+        VkShaderModule module = VK_NULL_HANDLE;
+        VkShaderModuleCreateInfo moduleInfo = {};
+        moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        moduleInfo.codeSize = shaderc_result_get_length(spirv);
+        moduleInfo.pCode = reinterpret_cast<const uint32_t*>(shaderc_result_get_bytes(spirv));
+        bool ok = compiled && check(vkCreateShaderModule(device, &moduleInfo, nullptr, &module), "vkCreateShaderModule");
+        shaderc_result_release(spirv);
+        shaderc_compile_options_release(options);
+        shaderc_compiler_release(compiler);
+        if (!ok) return false;
+
+        VkDescriptorSetLayoutBinding bindings[2] = {};
+        for (uint32_t i = 0; i < 2; i++) {
+            bindings[i].binding = i;
+            bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+        VkDescriptorSetLayoutCreateInfo setInfo = {};
+        setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        setInfo.bindingCount = 2;
+        setInfo.pBindings = bindings;
+        VkPushConstantRange range = { VK_SHADER_STAGE_COMPUTE_BIT, 0, 2 * sizeof(int32_t) };
+        VkPipelineLayoutCreateInfo layoutInfo = {};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutInfo.setLayoutCount = 1;
+        layoutInfo.pSetLayouts = &setLayout;
+        layoutInfo.pushConstantRangeCount = 1;
+        layoutInfo.pPushConstantRanges = &range;
+        VkComputePipelineCreateInfo pipelineInfo = {};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = module;
+        pipelineInfo.stage.pName = "main";
+        ok = check(vkCreateDescriptorSetLayout(device, &setInfo, nullptr, &setLayout), "vkCreateDescriptorSetLayout")
+          && check(vkCreatePipelineLayout(device, &layoutInfo, nullptr, &pipelineLayout), "vkCreatePipelineLayout");
+        pipelineInfo.layout = pipelineLayout;
+        ok = ok && check(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline), "vkCreateComputePipelines");
+        vkDestroyShaderModule(device, module, nullptr);
+        return ok;
+    }
+
+    bool createDescriptorSets() {
+        VkDescriptorPoolSize size = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 };
+        VkDescriptorPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets = 2;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &size;
+        if (!check(vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool), "vkCreateDescriptorPool")) return false;
+        VkDescriptorSetLayout layouts[2] = { setLayout, setLayout };
+        VkDescriptorSetAllocateInfo allocation = {};
+        allocation.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocation.descriptorPool = descriptorPool;
+        allocation.descriptorSetCount = 2;
+        allocation.pSetLayouts = layouts;
+        if (!check(vkAllocateDescriptorSets(device, &allocation, sets), "vkAllocateDescriptorSets")) return false;
+        for (int p = 0; p < 2; p++) {
+            VkDescriptorBufferInfo buffers[2] = { { cells[p], 0, VK_WHOLE_SIZE }, { cells[1 - p], 0, VK_WHOLE_SIZE } };
+            VkWriteDescriptorSet writes[2] = {};
+            for (uint32_t i = 0; i < 2; i++) {
+                writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                writes[i].dstSet = sets[p];
+                writes[i].dstBinding = i;
+                writes[i].descriptorCount = 1;
+                writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                writes[i].pBufferInfo = &buffers[i];
+            }
+            vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
+        }
+        return true;
+    }
+
+    static void memoryBarrier(VkCommandBuffer commands, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+                              VkPipelineStageFlags dstStages, VkAccessFlags dstAccess) {
+        VkMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(commands, srcStages, dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    // Every command buffer starts by waiting for the writes of whatever was
+    // submitted before it, so submissions can be chained in any order.
+    bool begin(VkCommandBuffer commands) {
+        VkCommandBufferBeginInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        info.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;  // the same batch may be queued several times over
+        if (!check(vkBeginCommandBuffer(commands, &info), "vkBeginCommandBuffer")) return false;
+        VkPipelineStageFlags stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+        memoryBarrier(commands, stages, VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, stages,
+                      VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+        return true;
+    }
+
+    void recordGenerations(VkCommandBuffer commands, int from, int generations) {
+        int32_t size[2] = { width, height };
+        vkCmdBindPipeline(commands, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+        vkCmdPushConstants(commands, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(size), size);
+        for (int g = 0; g < generations; g++) {
+            if (g > 0) {
+                memoryBarrier(commands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+            }
+            vkCmdBindDescriptorSets(commands, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &sets[(from + g) & 1], 0, nullptr);
+            vkCmdDispatch(commands, (width + 15) / 16, (height + 15) / 16, 1);
+        }
+    }
+
+    bool recordCommands() {
+        VkCommandPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = queueFamily;
+        if (!check(vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool), "vkCreateCommandPool")) return false;
+        VkCommandBuffer all[8];
+        VkCommandBufferAllocateInfo allocation = {};
+        allocation.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocation.commandPool = commandPool;
+        allocation.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocation.commandBufferCount = 8;
+        if (!check(vkAllocateCommandBuffers(device, &allocation, all), "vkAllocateCommandBuffers")) return false;
+        VkBufferCopy region = { 0, 0, VkDeviceSize(width) * height * sizeof(uint32_t) };
+        for (int p = 0; p < 2; p++) {
+            stepCommands[p] = all[p];
+            batchCommands[p] = all[2 + p];
+            uploadCommands[p] = all[4 + p];
+            downloadCommands[p] = all[6 + p];
+            if (!begin(stepCommands[p])) return false;
+            recordGenerations(stepCommands[p], p, 1);
+            if (!begin(batchCommands[p])) return false;
+            recordGenerations(batchCommands[p], p, VULKAN_BATCH);
+            if (!begin(uploadCommands[p])) return false;
+            vkCmdCopyBuffer(uploadCommands[p], staging, cells[p], 1, &region);
+            if (!begin(downloadCommands[p])) return false;
+            vkCmdCopyBuffer(downloadCommands[p], cells[p], staging, 1, &region);
+            memoryBarrier(downloadCommands[p], VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                          VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+        }
+        for (VkCommandBuffer commands : all) {
+            if (!check(vkEndCommandBuffer(commands), "vkEndCommandBuffer")) return false;
+        }
+        return true;
+    }
+
+    bool createTimeline() {
+        VkSemaphoreTypeCreateInfo type = {};
+        type.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        type.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        type.initialValue = 0;
+        VkSemaphoreCreateInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        info.pNext = &type;
+        return check(vkCreateSemaphore(device, &info, nullptr, &timeline), "vkCreateSemaphore");
+    }
+
+    void waitFor(uint64_t value) const {
+        VkSemaphoreWaitInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        info.semaphoreCount = 1;
+        info.pSemaphores = &timeline;
+        info.pValues = &value;
+        check(vkWaitSemaphores(device, &info, UINT64_MAX), "vkWaitSemaphores");
+    }
+
+    void submit(const VkCommandBuffer* commands, uint32_t count) const {
+        if (submitted >= VULKAN_MAX_IN_FLIGHT) waitFor(submitted + 1 - VULKAN_MAX_IN_FLIGHT);
+        uint64_t signal = ++submitted;
+        VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues = &signal;
+        VkSubmitInfo info = {};
+        info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        info.pNext = &timelineInfo;
+        info.commandBufferCount = count;
+        info.pCommandBuffers = commands;
+        info.signalSemaphoreCount = 1;
+        info.pSignalSemaphores = &timeline;
+        check(vkQueueSubmit(queue, 1, &info, VK_NULL_HANDLE), "vkQueueSubmit");
+    }
+
+    // Submits the counted steps as whole batches and single generations.
+    void flush() const {
+        if (!queued) return;
+        std::vector<VkCommandBuffer> commands;
+        for (; queued >= VULKAN_BATCH; queued -= VULKAN_BATCH) commands.push_back(batchCommands[current]);
+        for (; queued > 0; queued--) {
+            commands.push_back(stepCommands[current]);
+            current ^= 1;
+        }
+        submit(commands.data(), uint32_t(commands.size()));
+    }
+
+    bool init() {
+        return createInstance() && pickDevice() && createDevice() && createBuffers() && createPipeline()
+            && createDescriptorSets() && recordCommands() && createTimeline();
+    }
+
+public:
+    VulkanEngine(int width, int height, Rule rule, Boundary boundary)
+        : width(width), height(height), rule(rule), boundary(boundary), instance(VK_NULL_HANDLE), physicalDevice(VK_NULL_HANDLE),
+          device(VK_NULL_HANDLE), queue(VK_NULL_HANDLE), queueFamily(0), cells(), staging(VK_NULL_HANDLE), cellMemory(),
+          stagingMemory(VK_NULL_HANDLE), stagingCells(nullptr), setLayout(VK_NULL_HANDLE), pipelineLayout(VK_NULL_HANDLE),
+          pipeline(VK_NULL_HANDLE), descriptorPool(VK_NULL_HANDLE), sets(), commandPool(VK_NULL_HANDLE), stepCommands(),
+          batchCommands(), uploadCommands(), downloadCommands(), timeline(VK_NULL_HANDLE), submitted(0), current(0), queued(0) {
+        valid = init();
+    }
+
+    ~VulkanEngine() override {
+        if (device) {
+            vkDeviceWaitIdle(device);
+            vkDestroySemaphore(device, timeline, nullptr);
+            vkDestroyCommandPool(device, commandPool, nullptr);
+            vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+            vkDestroyPipeline(device, pipeline, nullptr);
+            vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+            vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+            vkDestroyBuffer(device, staging, nullptr);
+            vkFreeMemory(device, stagingMemory, nullptr);
+            for (int i = 0; i < 2; i++) {
+                vkDestroyBuffer(device, cells[i], nullptr);
+                vkFreeMemory(device, cellMemory[i], nullptr);
+            }
+            vkDestroyDevice(device, nullptr);
+        }
+        if (instance) vkDestroyInstance(instance, nullptr);
+    }
+
+    VulkanEngine(const VulkanEngine&) = delete;
+    VulkanEngine& operator=(const VulkanEngine&) = delete;
+
+    bool ok() const { return valid; }
+    // False when setup failed because no device qualified, not partway through.
+    bool hasDevice() const { return physicalDevice != VK_NULL_HANDLE; }
+
+    const char* name() const override { return "vulkan"; }
+
+    void load(const uint8_t* source) override {
+        finish();
+        for (size_t i = 0; i < size_t(width) * height; i++) stagingCells[i] = source[i] != 0;
+        submit(&uploadCommands[current], 1);
+    }
+
+    void store(uint8_t* target) const override {
+        flush();
+        submit(&downloadCommands[current], 1);
+        waitFor(submitted);
+        for (size_t i = 0; i < size_t(width) * height; i++) target[i] = stagingCells[i] ? 255 : 0;
+    }
+
+    void step() override {
+        if (++queued == VULKAN_BATCH) flush();
+    }
+
+    void finish() override {
+        flush();
+        waitFor(submitted);
+    }
+};